@@ -0,0 +1,161 @@
+// Replays scripted change_display_mode sequences against the core and the simulated backend and
+// reports end-to-end latency percentiles and window system calls per user action.
+//
+//   transition_bench [--iterations N] [--max-p99-ms MS] [--max-calls-per-action N]
+//
+// Latency is measured on the simulated clock, so it is deterministic and reflects what the
+// transition logic waits for, not how fast the benchmark machine is. Wall time is reported
+// separately as the CPU overhead of the core itself. Exits non-zero when a limit is exceeded.
+#include "simulated_backend.h"
+#include "transition_worker.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Virtual cost of one SetWindowPos, roughly what the engine spends answering a resize.
+static const uint64_t kSetPosCostUs = 4000;
+
+struct Bench
+{
+	SimulatedBackend backend;
+	DisplayModeController controller;
+	TransitionWorker worker;
+	WindowHandle window;
+
+	Bench()
+		: controller(backend), worker(controller)
+	{
+		backend.AddMonitor({ 0, 0, 1920, 1080 });
+		backend.AddMonitor({ 1920, 0, 4480, 1440 });
+		backend.AddMonitor({ -1280, 0, 0, 1024 });
+		window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE);
+		backend.SetPosCost(kSetPosCostUs);
+		controller.Attach();
+		controller.RefreshMonitors();
+		worker.Start();
+	}
+};
+
+struct Sample
+{
+	uint64_t latencyUs;
+	uint64_t wallUs;
+	int calls;
+};
+
+// One user action: everything submitted before the worker goes idle again.
+typedef std::function<void(Bench&, int iteration)> Action;
+
+struct Scenario
+{
+	const char* name;
+	Action action;
+};
+
+static void Submit(Bench& bench, int mode, int width, int height, int adapter)
+{
+	bench.worker.Submit({ mode, width, height, adapter });
+}
+
+static const Scenario kScenarios[] = {
+	{ "mode_toggle", [](Bench& bench, int i) {
+		Submit(bench, i % 2 ? DISPLAY_MODE_WINDOWED : DISPLAY_MODE_FULLSCREEN_WINDOWED, 1920, 1080, 0);
+	} },
+	{ "resolution_sweep", [](Bench& bench, int i) {
+		static const int sizes[][2] = { { 1280, 720 }, { 1600, 900 }, { 1920, 1080 }, { 1024, 768 }, { 2560, 1440 } };
+		Submit(bench, DISPLAY_MODE_WINDOWED, sizes[i % 5][0], sizes[i % 5][1], 0);
+	} },
+	{ "adapter_change", [](Bench& bench, int i) {
+		Submit(bench, DISPLAY_MODE_FULLSCREEN_WINDOWED, 1920, 1080, i % 3);
+	} },
+	{ "apply_settings_burst", [](Bench& bench, int i) {
+		// What one click in the video menu looks like from the plugin: the option callback,
+		// then the apply_render_settings hook, with the same target.
+		const int mode = i % 2 ? DISPLAY_MODE_WINDOWED : DISPLAY_MODE_FULLSCREEN_WINDOWED;
+		Submit(bench, mode, 1920, 1080, 0);
+		Submit(bench, mode, 1920, 1080, 0);
+		Submit(bench, mode, 1920, 1080, 0);
+	} },
+	{ "rapid_fire", [](Bench& bench, int i) {
+		for (int n = 0; n < 10; n++)
+			Submit(bench, (i + n) % 2 ? DISPLAY_MODE_WINDOWED : DISPLAY_MODE_FULLSCREEN_WINDOWED, 1280 + n * 64, 720 + n * 36, 0);
+	} },
+};
+
+int main(int argc, char** argv)
+{
+	int iterations = 200;
+	double maxP99Ms = 0;
+	double maxCallsPerAction = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!std::strcmp(argv[i], "--iterations") && i + 1 < argc)
+			iterations = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "--max-p99-ms") && i + 1 < argc)
+			maxP99Ms = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--max-calls-per-action") && i + 1 < argc)
+			maxCallsPerAction = std::atof(argv[++i]);
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--iterations N] [--max-p99-ms MS] [--max-calls-per-action N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	bool failed = false;
+	std::printf("%-22s %8s %9s %9s %9s %9s %12s\n", "scenario", "actions", "p50 ms", "p95 ms", "p99 ms", "wall us", "calls/action");
+	for (const Scenario& scenario : kScenarios)
+	{
+		Bench bench;
+		std::vector<Sample> samples;
+		for (int i = 0; i < iterations; i++)
+		{
+			const SimulatedBackend::Calls before = bench.backend.GetCalls();
+			const uint64_t start = bench.backend.GetTime();
+			const auto wallStart = std::chrono::steady_clock::now();
+			scenario.action(bench, i);
+			bench.worker.WaitIdle();
+			const auto wallEnd = std::chrono::steady_clock::now();
+			const SimulatedBackend::Calls after = bench.backend.GetCalls();
+			samples.push_back(Sample{
+				bench.backend.GetTime() - start,
+				(uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(wallEnd - wallStart).count(),
+				after.Total() - before.Total() });
+		}
+		bench.worker.Stop();
+
+		std::vector<uint64_t> latency;
+		std::vector<uint64_t> wall;
+		uint64_t calls = 0;
+		for (const Sample& sample : samples)
+		{
+			latency.push_back(sample.latencyUs);
+			wall.push_back(sample.wallUs);
+			calls += sample.calls;
+		}
+		std::sort(latency.begin(), latency.end());
+		std::sort(wall.begin(), wall.end());
+		const double p99 = Percentile(latency, 99) / 1000.0;
+		const double callsPerAction = samples.empty() ? 0.0 : (double)calls / samples.size();
+		std::printf("%-22s %8zu %9.2f %9.2f %9.2f %9llu %12.2f\n", scenario.name, samples.size(),
+			Percentile(latency, 50) / 1000.0, Percentile(latency, 95) / 1000.0, p99,
+			(unsigned long long)Percentile(wall, 50), callsPerAction);
+
+		if (maxP99Ms > 0 && p99 > maxP99Ms)
+		{
+			std::printf("  FAIL: p99 %.2f ms exceeds %.2f ms\n", p99, maxP99Ms);
+			failed = true;
+		}
+		if (maxCallsPerAction > 0 && callsPerAction > maxCallsPerAction)
+		{
+			std::printf("  FAIL: %.2f calls per action exceeds %.2f\n", callsPerAction, maxCallsPerAction);
+			failed = true;
+		}
+	}
+	return failed ? 1 : 0;
+}
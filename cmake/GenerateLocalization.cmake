@@ -0,0 +1,55 @@
+# Packs lua/loc/*.json into src/localization_bundle.inc, the string table compiled into the
+# plugin. Run through the regenerate_localization target after editing a translation:
+#   cmake -DLOC_DIR=<dir with the json files> -DOUTPUT=<inc file> -P GenerateLocalization.cmake
+cmake_minimum_required(VERSION 3.19)
+
+# Escapes a UTF-8 string for a C string literal. Everything outside printable ASCII becomes a
+# three digit octal escape, which unlike \x cannot swallow the character after it.
+function(escape_c_string input output)
+	string(HEX "${input}" hex)
+	string(LENGTH "${hex}" length)
+	set(result "")
+	set(i 0)
+	while(i LESS length)
+		string(SUBSTRING "${hex}" ${i} 2 byte)
+		math(EXPR code "0x${byte}")
+		if(code EQUAL 34 OR code EQUAL 92)
+			string(ASCII ${code} char)
+			string(APPEND result "\\${char}")
+		elseif(code GREATER_EQUAL 32 AND code LESS 127)
+			string(ASCII ${code} char)
+			string(APPEND result "${char}")
+		else()
+			math(EXPR d2 "${code} / 64")
+			math(EXPR d1 "(${code} / 8) % 8")
+			math(EXPR d0 "${code} % 8")
+			string(APPEND result "\\${d2}${d1}${d0}")
+		endif()
+		math(EXPR i "${i} + 2")
+	endwhile()
+	set(${output} "${result}" PARENT_SCOPE)
+endfunction()
+
+file(GLOB files "${LOC_DIR}/*.json")
+list(SORT files)
+set(content "// Generated from lua/loc/*.json by cmake/GenerateLocalization.cmake, do not edit. Rebuild\n")
+string(APPEND content "// it with the regenerate_localization target after changing a translation.\n")
+foreach(file IN LISTS files)
+	get_filename_component(language "${file}" NAME_WE)
+	file(READ "${file}" json)
+	string(JSON count LENGTH "${json}")
+	math(EXPR last "${count} - 1")
+	set(keys "")
+	foreach(index RANGE ${last})
+		string(JSON key MEMBER "${json}" ${index})
+		list(APPEND keys "${key}")
+	endforeach()
+	list(SORT keys)
+	foreach(key IN LISTS keys)
+		string(JSON text GET "${json}" "${key}")
+		escape_c_string("${key}" key_literal)
+		escape_c_string("${text}" text_literal)
+		string(APPEND content "{ \"${language}\", \"${key_literal}\", \"${text_literal}\" },\n")
+	endforeach()
+endforeach()
+file(WRITE "${OUTPUT}" "${content}")
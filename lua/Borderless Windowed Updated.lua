@@ -1,44 +1,178 @@
 FullscreenWindowed = FullscreenWindowed or {}
 
 FullscreenWindowed.mod_path = ModPath
-FullscreenWindowed.save_path = SavePath .. "FullscreenWindowed.json"
 _, FullscreenWindowed.library = blt.load_native(FullscreenWindowed.mod_path .. "Borderless Windowed Updated.dll")
 
 FullscreenWindowed._settings = {
-	display_mode = 0
+	display_mode = 0,
+	present_scaling = 0
 }
 
+-- The native module keeps the settings and writes FullscreenWindowed.json in the background.
 function FullscreenWindowed:save_settings()
-	local file = io.open(self.save_path, "w+")
-	if file then
-		file:write(json.encode(self._settings))
-		file:close()
+	for k, v in pairs(self._settings) do
+		self.library.set_setting(k, v)
 	end
 end
 
+-- Returns false when nothing was ever saved.
 function FullscreenWindowed:load_settings()
-	local file = io.open(self.save_path, "r")
-	if file then
-		for k, v in pairs(json.decode(file:read("*all")) or {}) do
-			self._settings[k] = v
+	local settings, loaded = self.library.get_settings(SavePath .. "FullscreenWindowed.json")
+	for k, v in pairs(settings) do
+		self._settings[k] = v
+	end
+	return loaded
+end
+
+-- Applies the mode, resolution and adapter as one native transition. Returns the request id.
+function FullscreenWindowed:apply_display_config(display_mode, resolution)
+	resolution = resolution or RenderSettings.resolution
+	-- Remembered for the native startup, which applies the saved mode before Lua runs.
+	self._settings.adapter_index = RenderSettings.adapter_index
+	self._settings.render_width = resolution.x
+	self._settings.render_height = resolution.y
+	self.library.set_setting("adapter_index", RenderSettings.adapter_index)
+	self.library.set_setting("render_width", resolution.x)
+	self.library.set_setting("render_height", resolution.y)
+	return self.library.apply_display_config({
+		mode = display_mode,
+		width = resolution.x,
+		height = resolution.y,
+		adapter = RenderSettings.adapter_index,
+		scaling = self._settings.present_scaling
+	})
+end
+
+-- Fullscreen windowed at the configured resolution instead of the monitor's, scaled on present:
+-- 0 off, 1 stretch, 2 keep aspect ratio, 3 integer multiples. Run it from the console, e.g.
+-- FullscreenWindowed:set_present_scaling(2).
+function FullscreenWindowed:set_present_scaling(scaling)
+	self._settings.present_scaling = scaling
+	self.library.set_setting("present_scaling", scaling)
+	return self:apply_display_config(self._settings.display_mode)
+end
+
+-- Switches the display mode the way the menu does, without confirmation and without saving.
+function FullscreenWindowed:set_display_mode(display_mode)
+	local old_display_mode = self._settings.display_mode
+	self._settings.display_mode = display_mode
+	if (display_mode == 0) ~= (old_display_mode == 0) then
+		managers.viewport:set_fullscreen(display_mode == 0)
+	end
+	return self:apply_display_config(display_mode)
+end
+
+-- Frame rate cap while the game is in the background, 0 to keep rendering at full speed. Run it
+-- from the console, e.g. FullscreenWindowed:set_background_fps_cap(15).
+function FullscreenWindowed:set_background_fps_cap(fps)
+	self._settings.background_fps_cap = fps
+	self.library.set_setting("background_fps_cap", fps)
+	self.library.set_background_fps_cap(fps)
+end
+
+-- Measures frame times in every display mode and writes the comparison to the save folder.
+-- Run it from the console, e.g. FullscreenWindowed:run_frame_benchmark(600, 3000).
+function FullscreenWindowed:run_frame_benchmark(frames, settle_ms)
+	return self.library.start_frame_benchmark({
+		frames = frames,
+		settle_ms = settle_ms,
+		restore_mode = self._settings.display_mode,
+		report_path = SavePath .. "FullscreenWindowed_benchmark.txt"
+	}, function(display_mode)
+		self:set_display_mode(display_mode)
+	end)
+end
+
+-- Callbacks waiting for the transition with the given request id to finish.
+FullscreenWindowed._transition_callbacks = {}
+
+function FullscreenWindowed:after_transition(id, callback)
+	if id then
+		self._transition_callbacks[id] = self._transition_callbacks[id] or {}
+		table.insert(self._transition_callbacks[id], callback)
+	else
+		callback()
+	end
+end
+
+-- Captures the window for a change the user may decline, once the transitions already in flight
+-- have finished so a rollback never restores a half-applied window. `change` then runs with the
+-- transaction id, nil when the window could not be read.
+function FullscreenWindowed:begin_transition(change)
+	self:after_transition(self.library.get_active_transition(), function()
+		change(self.library.begin_transition())
+	end)
+end
+
+-- The game's confirmation dialog only reports a decline. Its first button accepts, which
+-- commits the transaction here; a decline commits it after `on_decline` had the chance to roll
+-- back to it.
+function FullscreenWindowed:confirm_transition(transition, on_decline)
+	local library = self.library
+	local system_menu = managers.system_menu
+	local own_show = rawget(system_menu, "show")
+	local show = system_menu.show
+	system_menu.show = function(menu, dialog_data)
+		system_menu.show = own_show
+		local accept = dialog_data.button_list and dialog_data.button_list[1]
+		if accept and transition then
+			accept.callback_func = function()
+				library.commit(transition)
+			end
 		end
-		file:close()
+		return show(menu, dialog_data)
 	end
+	managers.menu:show_accept_gfx_settings_dialog(function()
+		on_decline()
+		if transition then
+			library.commit(transition)
+		end
+	end)
+	system_menu.show = own_show
 end
 
+FullscreenWindowed.library.set_transition_callback(function(result)
+	if result.deferred then
+		log("[FullscreenWindowed] Display mode change deferred: " .. tostring(result.error))
+	elseif not result.success then
+		log("[FullscreenWindowed] Display mode change failed: " .. tostring(result.error))
+	end
+	-- Requests replaced before they ran never report, the one that replaced them stands in.
+	local ready = {}
+	for id, callbacks in pairs(FullscreenWindowed._transition_callbacks) do
+		if id <= result.id then
+			FullscreenWindowed._transition_callbacks[id] = nil
+			for _, callback in ipairs(callbacks) do
+				table.insert(ready, callback)
+			end
+		end
+	end
+	-- Called after the walk, a callback may start another transition.
+	for _, callback in ipairs(ready) do
+		callback(result)
+	end
+end)
+
 Hooks:PostHook(__classes["Application"], "apply_render_settings", "FullscreenWindowedApplyRenderSettings", function(self)
-	FullscreenWindowed.library.change_display_mode(FullscreenWindowed._settings.display_mode, RenderSettings.resolution.x, RenderSettings.resolution.y, RenderSettings.adapter_index)
+	FullscreenWindowed.library.note_render_settings_applied()
+	FullscreenWindowed:apply_display_config(FullscreenWindowed._settings.display_mode)
 end)
 
 Hooks:PostHook(Setup, "init_managers", "FullscreenWindowedInit", function(self, managers)
-	if io.file_is_readable(FullscreenWindowed.save_path) then
-		FullscreenWindowed:load_settings()
-		FullscreenWindowed.library.change_display_mode(FullscreenWindowed._settings.display_mode, RenderSettings.resolution.x, RenderSettings.resolution.y, RenderSettings.adapter_index)
+	if FullscreenWindowed:load_settings() then
+		-- A saved borderless mode is already in place from the native startup, which makes this a
+		-- no-op for it.
+		FullscreenWindowed:apply_display_config(FullscreenWindowed._settings.display_mode)
 	else
 		FullscreenWindowed._settings.display_mode = managers.viewport:is_fullscreen() and 0 or 1
 	end
 end)
 
+-- The native side has no unload hook, so the settings are saved for good here.
+Hooks:PreHook(Setup, "quit", "FullscreenWindowedQuit", function(self)
+	FullscreenWindowed.library.stop_settings()
+end)
+
 Hooks:PostHook(MenuOptionInitiator, "modify_video", "FullscreenWindowedDisplayMode", function(self, node)
 	local adapter_item = node:item("choose_video_adapter")
 	if adapter_item then
@@ -57,26 +191,39 @@ Hooks:PostHook(MenuOptionInitiator, "modify_video", "FullscreenWindowedDisplayMo
 			return
 		end
 
-		managers.viewport:set_fullscreen(choice == 0)
-		FullscreenWindowed.library.change_display_mode(choice, RenderSettings.resolution.x, RenderSettings.resolution.y, RenderSettings.adapter_index)
 		local old_display_mode = FullscreenWindowed._settings.display_mode
+		-- Windowed and fullscreen windowed are both windowed to the renderer, so switching between
+		-- them is a restyle only and must not make the engine reset its device.
+		local exclusive_change = choice == 0 or old_display_mode == 0
 		FullscreenWindowed._settings.display_mode = choice
-		FullscreenWindowed:save_settings()
-		managers.menu:show_accept_gfx_settings_dialog(function ()
-			managers.viewport:set_fullscreen(old_display_mode == 0)
-			FullscreenWindowed.library.change_display_mode(old_display_mode, RenderSettings.resolution.x, RenderSettings.resolution.y, RenderSettings.adapter_index)
-			FullscreenWindowed._settings.display_mode = old_display_mode
+		FullscreenWindowed:begin_transition(function(transition)
+			if exclusive_change then
+				managers.viewport:set_fullscreen(choice == 0)
+			end
+			local request = FullscreenWindowed:apply_display_config(choice)
 			FullscreenWindowed:save_settings()
-			dm_item:set_value(FullscreenWindowed._settings.old_display_mode)
+			FullscreenWindowed:confirm_transition(transition, function()
+				if exclusive_change then
+					managers.viewport:set_fullscreen(old_display_mode == 0)
+				end
+				if old_display_mode == 0 or not transition or not FullscreenWindowed.library.rollback(transition) then
+					FullscreenWindowed:apply_display_config(old_display_mode)
+				end
+				FullscreenWindowed._settings.display_mode = old_display_mode
+				FullscreenWindowed:save_settings()
+				dm_item:set_value(FullscreenWindowed._settings.old_display_mode)
+				if br_item then
+					br_item:set_enabled(old_display_mode == 0)
+				end
+				self:refresh_node()
+			end)
 			if br_item then
-				br_item:set_enabled(old_display_mode == 0)
+				br_item:set_enabled(choice == 0)
 			end
-			self:refresh_node()
+			FullscreenWindowed:after_transition(request, function()
+				self:refresh_node()
+			end)
 		end)
-		if br_item then
-			br_item:set_enabled(choice == 0)
-		end
-		self:refresh_node()
 	end
 
 	local fs_item = node:item("toggle_fullscreen")
@@ -126,54 +273,31 @@ function MenuCallbackHandler:change_resolution(item)
 		return
 	end
 
-	managers.viewport:set_resolution(item:parameters().resolution)
-	managers.viewport:set_aspect_ratio(item:parameters().resolution.x / item:parameters().resolution.y)
-	FullscreenWindowed.library.change_display_mode(FullscreenWindowed._settings.display_mode, item:parameters().resolution.x, item:parameters().resolution.y, RenderSettings.adapter_index)
-
-	local function on_decline()
-		managers.viewport:set_resolution(old_resolution)
-		managers.viewport:set_aspect_ratio(old_resolution.x / old_resolution.y)
-		FullscreenWindowed.library.change_display_mode(FullscreenWindowed._settings.display_mode, old_resolution.x, old_resolution.y, RenderSettings.adapter_index)
-	end
+	local resolution = item:parameters().resolution
+	FullscreenWindowed:begin_transition(function(transition)
+		managers.viewport:set_resolution(resolution)
+		managers.viewport:set_aspect_ratio(resolution.x / resolution.y)
+		FullscreenWindowed:apply_display_config(FullscreenWindowed._settings.display_mode, resolution)
 
-	managers.menu:show_accept_gfx_settings_dialog(on_decline)
+		FullscreenWindowed:confirm_transition(transition, function()
+			managers.viewport:set_resolution(old_resolution)
+			managers.viewport:set_aspect_ratio(old_resolution.x / old_resolution.y)
+			if FullscreenWindowed._settings.display_mode == 0 or not transition or not FullscreenWindowed.library.rollback(transition) then
+				FullscreenWindowed:apply_display_config(FullscreenWindowed._settings.display_mode, old_resolution)
+			end
+		end)
+	end)
 end
 
 Hooks:Add("LocalizationManagerPostInit", "FullscreenWindowedAddLocalization", function(loc)
-	local languages = {
-		[Idstring("english"):key()] = "english",
-		[Idstring("french"):key()] = "french",
-		[Idstring("russian"):key()] = "russian",
-		[Idstring("dutch"):key()] = "dutch",
-		[Idstring("german"):key()] = "german",
-		[Idstring("italian"):key()] = "italian",
-		[Idstring("spanish"):key()] = "spanish",
-		[Idstring("japanese"):key()] = "japanese",
-		[Idstring("schinese"):key()] = "schinese",
-		[Idstring("tchinese"):key()] = "tchinese",
-		[Idstring("korean"):key()] = "korean",
-		[Idstring("finnish"):key()] = "finnish",
-		[Idstring("swedish"):key()] = "swedish",
-		[Idstring("portuguese"):key()] = "portuguese",
-		[Idstring("turkish"):key()] = "turkish",
-		[Idstring("danish"):key()] = "danish",
-		[Idstring("norwegian"):key()] = "norwegian",
-		[Idstring("polish"):key()] = "polish"
-	}
-
-	local lang = languages[SystemInfo:language():key()]
-	if lang == nil then
-		lang = "english"
-	end
-
-	local lang_exist = io.file_is_readable(FullscreenWindowed.mod_path .. "/loc/" .. lang .. ".json")
-	if not lang_exist then
-		loc:add_localized_strings({
-			["menu_display_mode"] = "Display Mode",
-			["menu_windowed"] = "Windowed",
-			["menu_fullscreen_windowed"] = "Fullscreen Windowed"
-		})
-		return
+	-- The strings of loc/*.json are compiled into the native module, no files are read here.
+	local strings, languages = FullscreenWindowed.library.get_localized_strings("english")
+	local language = SystemInfo:language():key()
+	for _, name in ipairs(languages) do
+		if Idstring(name):key() == language then
+			strings = FullscreenWindowed.library.get_localized_strings(name)
+			break
+		end
 	end
-	LocalizationManager:load_localization_file(FullscreenWindowed.mod_path .. "/loc/" .. lang .. ".json")
+	loc:add_localized_strings(strings)
 end)
@@ -0,0 +1,678 @@
+#include "display_mode.h"
+#include <algorithm>
+#include <cstdio>
+
+// The engine usually needs well under the 100 ms the plugin used to sleep unconditionally; the
+// timeout only matters on slow machines, where the old fixed sleep was simply too short.
+static const ReadinessOptions kDefaultReadinessOptions = { 500, 16, 2, true };
+
+static void Mark(TransitionTimeline* timeline, TransitionStage stage)
+{
+	if (timeline)
+		timeline->Mark(stage);
+}
+
+static const char* kFlipBlockerNames[FLIP_BLOCKER_COUNT] = { "no_window", "monitor_rect", "style", "ex_style", "minimized", "hidden" };
+
+// Any of these makes the window something other than a plain popup.
+static const uint32_t kFlipBlockingStyles = BW_WS_CAPTION | BW_WS_THICKFRAME;
+static const uint32_t kFlipBlockingExStyles = BW_WS_EX_LAYERED | BW_WS_EX_TRANSPARENT | BW_WS_EX_WINDOWEDGE | BW_WS_EX_CLIENTEDGE
+	| BW_WS_EX_STATICEDGE | BW_WS_EX_DLGMODALFRAME;
+
+const char* GetFlipBlockerName(int bit)
+{
+	return bit >= 0 && bit < FLIP_BLOCKER_COUNT ? kFlipBlockerNames[bit] : "unknown";
+}
+
+static const MonitorInfo* FindMonitorWithRect(const MonitorTopologySnapshot& topology, const WindowRect& rect)
+{
+	for (const MonitorInfo& monitor : topology.monitors)
+	{
+		if (monitor.rect == rect)
+			return &monitor;
+	}
+	return nullptr;
+}
+
+uint32_t CheckFlipEligibility(const WindowState& state, const MonitorTopologySnapshot& topology)
+{
+	uint32_t blockers = 0;
+	if (!FindMonitorWithRect(topology, state.rect))
+		blockers |= FLIP_BLOCKER_MONITOR_RECT;
+	if (!(state.style & BW_WS_POPUP) || (state.style & kFlipBlockingStyles))
+		blockers |= FLIP_BLOCKER_STYLE;
+	if (state.exStyle & kFlipBlockingExStyles)
+		blockers |= FLIP_BLOCKER_EX_STYLE;
+	if (state.minimized)
+		blockers |= FLIP_BLOCKER_MINIMIZED;
+	if (!(state.style & BW_WS_VISIBLE))
+		blockers |= FLIP_BLOCKER_HIDDEN;
+	return blockers;
+}
+
+WindowRect ComputePresentRect(int width, int height, const WindowRect& monitor, int scaling)
+{
+	if ((scaling != PRESENT_SCALING_ASPECT && scaling != PRESENT_SCALING_INTEGER) || width <= 0 || height <= 0)
+		return monitor;
+	const int monitorWidth = monitor.Width();
+	const int monitorHeight = monitor.Height();
+	const int factor = std::min(monitorWidth / width, monitorHeight / height);
+	int presentWidth;
+	int presentHeight;
+	if (scaling == PRESENT_SCALING_INTEGER && factor >= 1)
+	{
+		presentWidth = width * factor;
+		presentHeight = height * factor;
+	}
+	else if ((int64_t)monitorWidth * height <= (int64_t)monitorHeight * width)
+	{
+		presentWidth = monitorWidth;
+		presentHeight = (int)((int64_t)monitorWidth * height / width);
+	}
+	else
+	{
+		presentWidth = (int)((int64_t)monitorHeight * width / height);
+		presentHeight = monitorHeight;
+	}
+	const int left = monitor.left + (monitorWidth - presentWidth) / 2;
+	const int top = monitor.top + (monitorHeight - presentHeight) / 2;
+	return { left, top, left + presentWidth, top + presentHeight };
+}
+
+DisplayModeController::DisplayModeController(WindowBackend& backend)
+	: m_backend(backend), m_hWnd(nullptr), m_topology(backend), m_trace(nullptr), m_mode(-1), m_dpiAwareness(BW_DPI_UNAWARE), m_deferred(false), m_readinessOptions(kDefaultReadinessOptions), m_readinessReport(),
+	m_reconcileCounters(), m_resizeCounters(), m_holdingResizes(false), m_resizesHeld(false), m_movesHeld(false), m_flipEnforced(false),
+	m_flipReport(), m_present(), m_lastApplied(), m_hasApplied(false)
+{
+}
+
+bool DisplayModeController::Attach()
+{
+	m_hWnd = m_backend.FindGameWindow();
+	return m_hWnd != nullptr;
+}
+
+void DisplayModeController::WatchWindow(std::function<void()> attached)
+{
+	m_backend.SetGameWindowCallback([this, attached](WindowHandle window) {
+		// The backend may report the window Attach() already found.
+		if (m_hWnd.exchange(window) == window)
+			return;
+		if (attached)
+			attached();
+	});
+	Attach();
+}
+
+bool DisplayModeController::EnsureWindow()
+{
+	WindowHandle window = m_hWnd;
+	if (!window || !m_backend.IsWindowValid(window))
+	{
+		window = m_backend.FindGameWindow();
+		m_hWnd = window;
+		if (!window)
+			return false;
+	}
+	MatchDpiAwareness();
+	return true;
+}
+
+void DisplayModeController::RefreshMonitors()
+{
+	// Display changes are reported on the backend's thread, which has to read the monitors in
+	// the window's coordinate space as well.
+	m_backend.SetDisplayChangeCallback([this] {
+		MatchThreadDpiAwareness();
+		m_topology.Rebuild();
+	});
+	MatchThreadDpiAwareness();
+	m_topology.Rebuild();
+}
+
+WindowRect DisplayModeController::GetMonitorRect(int adapter)
+{
+	const std::shared_ptr<const MonitorTopologySnapshot> topology = m_topology.GetSnapshot();
+	if (const MonitorInfo* monitor = topology->GetAdapterMonitor(adapter))
+		return monitor->rect;
+	return topology->desktop;
+}
+
+unsigned int DisplayModeController::GetAdapterDpi(int adapter)
+{
+	const std::shared_ptr<const MonitorTopologySnapshot> topology = m_topology.GetSnapshot();
+	const MonitorInfo* monitor = topology->GetAdapterMonitor(adapter);
+	return monitor && monitor->dpi ? monitor->dpi : BW_DEFAULT_DPI;
+}
+
+int DisplayModeController::MatchThreadDpiAwareness()
+{
+	const WindowHandle window = m_hWnd;
+	const int awareness = m_backend.SetThreadDpiAwareness(window ? m_backend.GetWindowDpiAwareness(window) : BW_DPI_PER_MONITOR_AWARE_V2);
+	m_dpiAwareness = awareness;
+	return awareness;
+}
+
+int DisplayModeController::MatchDpiAwareness()
+{
+	const int previous = m_dpiAwareness;
+	const int awareness = MatchThreadDpiAwareness();
+	// Monitor rects and DPIs read in another coordinate space are virtualised differently.
+	if (awareness != previous)
+		m_topology.Rebuild();
+	return awareness;
+}
+
+const WindowState* DisplayModeController::ReadWindowState(WindowState& state)
+{
+	return m_backend.GetWindowState(m_hWnd, state) ? &state : nullptr;
+}
+
+bool DisplayModeController::ApplyStyles(const WindowState* current, uint32_t style, uint32_t exStyle)
+{
+	const bool styleChanged = !current || current->style != style;
+	const bool exStyleChanged = !current || current->exStyle != exStyle;
+	if (styleChanged)
+		m_backend.SetWindowStyle(m_hWnd, style);
+	if (exStyleChanged)
+		m_backend.SetWindowExStyle(m_hWnd, exStyle);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	(styleChanged ? m_reconcileCounters.styleApplied : m_reconcileCounters.styleSkipped)++;
+	(exStyleChanged ? m_reconcileCounters.exStyleApplied : m_reconcileCounters.exStyleSkipped)++;
+	m_lastApplied.style = style;
+	m_lastApplied.exStyle = exStyle;
+	return styleChanged || exStyleChanged;
+}
+
+void DisplayModeController::ApplyPosition(const WindowState* current, WindowZOrder order, const WindowRect& rect, bool frameChanged)
+{
+	const bool changed = frameChanged || !current || current->rect != rect;
+	if (changed)
+		m_backend.SetWindowPos(m_hWnd, order, rect.left, rect.top, rect.Width(), rect.Height(), frameChanged);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	(changed ? m_reconcileCounters.posApplied : m_reconcileCounters.posSkipped)++;
+	if (frameChanged)
+		m_reconcileCounters.frameChanges++;
+	m_lastApplied.rect = rect;
+	m_hasApplied = true;
+}
+
+void DisplayModeController::TraceResizeMessage(const char* name, const char* action, const WindowRect& rect)
+{
+	if (!m_trace || !m_trace->IsEnabled())
+		return;
+	char args[128];
+	std::snprintf(args, sizeof(args), "\"action\":\"%s\",\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d", action, rect.left, rect.top, rect.Width(),
+		rect.Height());
+	m_trace->Instant(TRACE_THREAD_WINDOW, "message", name, m_backend.GetTime(), args);
+}
+
+void DisplayModeController::BeginResizeHold()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_holdingResizes = true;
+	m_resizesHeld = false;
+	m_movesHeld = false;
+	m_resizeCounters.lastTransitionDelivered = 0;
+	m_resizeCounters.transitions++;
+}
+
+void DisplayModeController::EndResizeHold()
+{
+	bool held;
+	bool moved;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_holdingResizes = false;
+		held = m_resizesHeld;
+		moved = m_movesHeld;
+	}
+	// The held WM_WINDOWPOSCHANGED never reached default handling, which is what would have sent
+	// the engine its WM_MOVE, in that order before WM_SIZE.
+	WindowState state;
+	const bool known = (moved || held) && m_backend.GetWindowState(m_hWnd, state);
+	if (moved)
+	{
+		m_backend.PostMove(m_hWnd);
+		if (known)
+			TraceResizeMessage("WM_MOVE", "released", state.rect);
+	}
+	if (held)
+	{
+		m_backend.PostResize(m_hWnd);
+		if (known)
+			TraceResizeMessage("WM_SIZE", "released", state.rect);
+	}
+}
+
+bool DisplayModeController::FilterMessage(WindowMessage& message)
+{
+	if (message.type != WINDOW_MESSAGE_SIZE && message.type != WINDOW_MESSAGE_WINDOW_POS_CHANGED)
+		return false;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_holdingResizes)
+	{
+		m_resizesHeld = true;
+		if (message.type == WINDOW_MESSAGE_WINDOW_POS_CHANGED)
+			m_movesHeld = true;
+		m_resizeCounters.held++;
+		lock.unlock();
+		TraceResizeMessage(message.type == WINDOW_MESSAGE_SIZE ? "WM_SIZE" : "WM_WINDOWPOSCHANGED", "held", message.rect);
+		return true;
+	}
+	if (message.type == WINDOW_MESSAGE_SIZE)
+	{
+		if (m_present.renderWidth && !message.minimized)
+			message.rect = { 0, 0, m_present.renderWidth, m_present.renderHeight };
+		m_resizeCounters.delivered++;
+		m_resizeCounters.lastTransitionDelivered++;
+	}
+	return false;
+}
+
+bool DisplayModeController::SetPresentState(const PresentState& present)
+{
+	bool backdropChanged;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (present == m_present)
+			return false;
+		backdropChanged = present.backdrop != m_present.backdrop || (present.backdrop && present.monitor != m_present.monitor);
+		m_present = present;
+	}
+	if (backdropChanged)
+		m_backend.SetBackdrop(m_hWnd, present.backdrop ? &present.monitor : nullptr);
+	return true;
+}
+
+PresentState DisplayModeController::GetPresentState()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_present;
+}
+
+bool DisplayModeController::Windowed(int width, int height, int adapter, TransitionTimeline* timeline)
+{
+	return Windowed({ DISPLAY_MODE_WINDOWED, width, height, adapter }, timeline);
+}
+
+bool DisplayModeController::Windowed(const DisplayConfig& config, TransitionTimeline* timeline)
+{
+	if (!EnsureWindow())
+		return Fail("no game window");
+	SetPresentState(PresentState());
+	WindowState state;
+	const WindowState* current = ReadWindowState(state);
+	BeginResizeHold();
+	const bool styleChanged = ApplyStyles(current, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE);
+	Mark(timeline, TRANSITION_STAGE_STYLE);
+	// The frame is sized for the monitor the window lands on, the client size stays in pixels. A
+	// window created before the process became per-monitor aware keeps its own DPI everywhere.
+	const unsigned int dpi = m_backend.GetWindowDpiAwareness(m_hWnd) >= BW_DPI_PER_MONITOR_AWARE ? GetAdapterDpi(config.adapter)
+		: m_backend.GetWindowDpi(m_hWnd);
+	WindowRect rect = m_backend.AdjustWindowRect({ 0, 0, config.width, config.height }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE, dpi);
+	Mark(timeline, TRANSITION_STAGE_ADJUST_RECT);
+	const int window_width = rect.Width();
+	const int window_height = rect.Height();
+	rect = GetMonitorRect(config.adapter);
+	const int screen_width = rect.Width();
+	const int screen_height = rect.Height();
+	if (config.positioned)
+	{
+		rect.left += config.x;
+		rect.top += config.y;
+	}
+	else
+	{
+		if (screen_width >= window_width)
+			rect.left += (screen_width - window_width) / 2;
+		if (screen_height >= window_height)
+			rect.top += (screen_height - window_height) / 2;
+	}
+	ApplyPosition(current, WindowZOrder::NoTopmost, { rect.left, rect.top, rect.left + window_width, rect.top + window_height }, styleChanged);
+	EndResizeHold();
+	Mark(timeline, TRANSITION_STAGE_SET_POS);
+	return true;
+}
+
+WindowRect DisplayModeController::GetFullscreenRect(int adapter)
+{
+	if (!m_flipEnforced)
+		return GetMonitorRect(adapter);
+	const std::shared_ptr<const MonitorTopologySnapshot> topology = m_topology.GetSnapshot();
+	if (const MonitorInfo* monitor = topology->GetAdapterMonitor(adapter))
+		return monitor->rect;
+	for (const MonitorInfo& monitor : topology->monitors)
+	{
+		if (monitor.primary)
+			return monitor.rect;
+	}
+	return topology->monitors.empty() ? topology->desktop : topology->monitors[0].rect;
+}
+
+void DisplayModeController::SetFlipEnforced(bool enforced)
+{
+	m_flipEnforced = enforced;
+}
+
+FlipReport DisplayModeController::CheckFlip()
+{
+	WindowState state;
+	return RecordFlipCheck(m_backend.GetWindowState(m_hWnd, state) ? &state : nullptr);
+}
+
+FlipReport DisplayModeController::RecordFlipCheck(const WindowState* state)
+{
+	const std::shared_ptr<const MonitorTopologySnapshot> topology = m_topology.GetSnapshot();
+	uint32_t blockers = FLIP_BLOCKER_NO_WINDOW;
+	const MonitorInfo* monitor = nullptr;
+	if (state)
+	{
+		blockers = CheckFlipEligibility(*state, *topology);
+		monitor = FindMonitorWithRect(*topology, state->rect);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_flipReport.blockers = blockers;
+	m_flipReport.monitor = monitor ? monitor->rect : WindowRect{ 0, 0, 0, 0 };
+	m_flipReport.checks++;
+	if (blockers)
+		m_flipReport.failures++;
+	return m_flipReport;
+}
+
+FlipReport DisplayModeController::GetFlipReport()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_flipReport;
+}
+
+bool DisplayModeController::FullscreenWindowed(int adapter, TransitionTimeline* timeline)
+{
+	return FullscreenWindowed({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 0, 0, adapter }, timeline);
+}
+
+bool DisplayModeController::FullscreenWindowed(const DisplayConfig& config, TransitionTimeline* timeline)
+{
+	if (!EnsureWindow())
+		return Fail("no game window");
+	const WindowRect monitor = GetFullscreenRect(config.adapter);
+	int scaling = config.scaling;
+	const bool stretched = m_flipEnforced && (scaling == PRESENT_SCALING_ASPECT || scaling == PRESENT_SCALING_INTEGER);
+	if (stretched)
+		scaling = PRESENT_SCALING_STRETCH;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_flipReport.scalingStretched = stretched;
+	}
+	PresentState present = {};
+	if (scaling > PRESENT_SCALING_NONE && scaling < PRESENT_SCALING_COUNT && config.width > 0 && config.height > 0)
+	{
+		present.renderWidth = config.width;
+		present.renderHeight = config.height;
+	}
+	const WindowRect target = present.renderWidth ? ComputePresentRect(config.width, config.height, monitor, scaling) : monitor;
+	present.backdrop = target != monitor;
+	present.monitor = monitor;
+	WindowState state;
+	const WindowState* current = ReadWindowState(state);
+	// Re-applying settings while already borderless: the engine has nothing to reset, so there
+	// is nothing to wait for either.
+	const bool inPlace = current && !current->exclusiveFullscreen && !current->minimized
+		&& current->style == PAYDAY2_FULLSCREEN_WINDOWED_STYLE && current->exStyle == 0 && current->rect == target;
+	if (!inPlace)
+	{
+		const bool ready = WaitForEngineReady();
+		if (!ready && !GetReadinessOptions().proceedOnTimeout)
+		{
+			Mark(timeline, TRANSITION_STAGE_READY_WAIT);
+			return Fail("engine not ready before timeout");
+		}
+		current = ReadWindowState(state);
+	}
+	Mark(timeline, TRANSITION_STAGE_READY_WAIT);
+	if (m_flipEnforced)
+	{
+		// Checked on the state the transition would leave, before anything changes. The styles
+		// are replaced anyway, so only the target rect and the window's own state can block.
+		WindowState expected = current ? *current : WindowState();
+		expected.style = PAYDAY2_FULLSCREEN_WINDOWED_STYLE;
+		expected.exStyle = 0;
+		expected.rect = target;
+		const uint32_t blockers = RecordFlipCheck(current ? &expected : nullptr).blockers;
+		if (blockers == FLIP_BLOCKER_MINIMIZED)
+			return Defer("window minimized");
+		if (blockers)
+			return Fail("window would not qualify for independent flip");
+	}
+	// Only the render size changed: the window stays, the engine has to hear about it.
+	if (SetPresentState(present) && inPlace)
+		m_backend.PostResize(m_hWnd);
+	// Held only now: the sizes the engine sends itself during its reset must reach it.
+	BeginResizeHold();
+	const bool styleChanged = ApplyStyles(current, PAYDAY2_FULLSCREEN_WINDOWED_STYLE, 0);
+	Mark(timeline, TRANSITION_STAGE_STYLE);
+	ApplyPosition(current, WindowZOrder::Top, target, styleChanged);
+	EndResizeHold();
+	Mark(timeline, TRANSITION_STAGE_SET_POS);
+	return true;
+}
+
+bool DisplayModeController::WaitForEngineReady()
+{
+	const ReadinessOptions options = GetReadinessOptions();
+	const uint64_t start = m_backend.GetTime();
+	const uint64_t timeout = options.timeoutMs * 1000ull;
+	const uint64_t settle = options.settleMs * 1000ull;
+
+	WindowState last;
+	bool ready = false;
+	bool known = m_backend.GetWindowState(m_hWnd, last);
+	// A window already usable on the first look costs nothing. The settle time only applies
+	// once the engine was seen changing it.
+	bool changed = false;
+	uint64_t stableSince = start;
+	uint64_t now = start;
+	for (;;)
+	{
+		if (known && !last.minimized && !last.exclusiveFullscreen && (!changed || now - stableSince >= settle))
+		{
+			ready = true;
+			break;
+		}
+		if (now - start >= timeout)
+			break;
+		m_backend.Sleep(options.pollMs);
+		now = m_backend.GetTime();
+		WindowState state;
+		if (!m_backend.GetWindowState(m_hWnd, state))
+		{
+			known = false;
+			continue;
+		}
+		if (!known || state != last)
+		{
+			if (m_trace && m_trace->IsEnabled())
+			{
+				char args[128];
+				std::snprintf(args, sizeof(args), "\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d,\"minimized\":%s,\"exclusive\":%s",
+					state.rect.left, state.rect.top, state.rect.Width(), state.rect.Height(), state.minimized ? "true" : "false",
+					state.exclusiveFullscreen ? "true" : "false");
+				m_trace->Instant(TRACE_THREAD_WORKER, "window", "window_changed", now, args);
+			}
+			last = state;
+			known = true;
+			changed = true;
+			stableSince = now;
+		}
+	}
+
+	const uint64_t waited = now - start;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_readinessReport.lastWaitUs = waited;
+	m_readinessReport.lastTimedOut = !ready;
+	if (waited > m_readinessReport.maxWaitUs)
+		m_readinessReport.maxWaitUs = waited;
+	m_readinessReport.totalWaitUs += waited;
+	m_readinessReport.waits++;
+	if (!ready)
+		m_readinessReport.timeouts++;
+	return ready;
+}
+
+void DisplayModeController::SetReadinessOptions(const ReadinessOptions& options)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_readinessOptions = options;
+	if (m_readinessOptions.pollMs == 0)
+		m_readinessOptions.pollMs = 1;
+}
+
+ReadinessOptions DisplayModeController::GetReadinessOptions()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_readinessOptions;
+}
+
+ReadinessReport DisplayModeController::GetReadinessReport()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_readinessReport;
+}
+
+ReconcileCounters DisplayModeController::GetReconcileCounters()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_reconcileCounters;
+}
+
+ResizeCounters DisplayModeController::GetResizeCounters()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_resizeCounters;
+}
+
+bool DisplayModeController::GetLastApplied(WindowState& state)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	state = m_lastApplied;
+	return m_hasApplied;
+}
+
+bool DisplayModeController::ChangeDisplayMode(int mode, int width, int height, int adapter, TransitionTimeline* timeline)
+{
+	return ApplyDisplayConfig({ mode, width, height, adapter }, timeline);
+}
+
+bool DisplayModeController::ApplyDisplayConfig(const DisplayConfig& config, TransitionTimeline* timeline)
+{
+	m_lastError.clear();
+	m_deferred = false;
+	bool applied;
+	switch (config.mode)
+	{
+	case DISPLAY_MODE_FULLSCREEN:
+		SetPresentState(PresentState());
+		applied = true;
+		break;
+	case DISPLAY_MODE_WINDOWED:
+		applied = Windowed(config, timeline);
+		break;
+	case DISPLAY_MODE_FULLSCREEN_WINDOWED:
+		applied = FullscreenWindowed(config, timeline);
+		break;
+	default:
+		return Fail("unknown display mode");
+	}
+	if (applied)
+		m_mode = config.mode;
+	return applied;
+}
+
+bool DisplayModeController::Fail(const char* error)
+{
+	m_lastError = error;
+	return false;
+}
+
+bool DisplayModeController::Defer(const char* error)
+{
+	m_deferred = true;
+	return Fail(error);
+}
+
+static const MonitorInfo* FindMonitor(const MonitorTopologySnapshot& topology, const WindowRect& rect)
+{
+	const int x = rect.left + rect.Width() / 2;
+	const int y = rect.top + rect.Height() / 2;
+	for (const MonitorInfo& monitor : topology.monitors)
+	{
+		if (x >= monitor.rect.left && x < monitor.rect.right && y >= monitor.rect.top && y < monitor.rect.bottom)
+			return &monitor;
+	}
+	return nullptr;
+}
+
+bool DisplayModeController::CaptureSnapshot(WindowSnapshot& snapshot)
+{
+	if (!m_backend.GetWindowState(m_hWnd, snapshot.state))
+		return false;
+	snapshot.mode = m_mode;
+	const std::shared_ptr<const MonitorTopologySnapshot> topology = m_topology.GetSnapshot();
+	const MonitorInfo* monitor = FindMonitor(*topology, snapshot.state.rect);
+	snapshot.monitorDevice = monitor ? monitor->deviceName : std::string();
+	snapshot.monitorRect = monitor ? monitor->rect : WindowRect{ 0, 0, 0, 0 };
+	snapshot.present = GetPresentState();
+	return true;
+}
+
+bool DisplayModeController::Restore(const WindowSnapshot& snapshot, TransitionTimeline* timeline)
+{
+	m_lastError.clear();
+	m_deferred = false;
+	if (!EnsureWindow())
+		return Fail("no game window");
+	WindowState state;
+	const WindowState* current = ReadWindowState(state);
+	// Rolling back out of exclusive fullscreen still has to let the engine finish its reset.
+	if (current && current->exclusiveFullscreen)
+	{
+		WaitForEngineReady();
+		current = ReadWindowState(state);
+	}
+	Mark(timeline, TRANSITION_STAGE_READY_WAIT);
+
+	// Follow the monitor if it was rearranged since the capture, or fall back to the primary
+	// one if it is gone, keeping the window's offset within it.
+	WindowRect rect = snapshot.state.rect;
+	if (!snapshot.monitorDevice.empty())
+	{
+		const std::shared_ptr<const MonitorTopologySnapshot> topology = m_topology.GetSnapshot();
+		const MonitorInfo* monitor = nullptr;
+		for (const MonitorInfo& candidate : topology->monitors)
+		{
+			if (candidate.deviceName == snapshot.monitorDevice || (!monitor && candidate.primary))
+				monitor = &candidate;
+		}
+		if (monitor)
+		{
+			const int dx = monitor->rect.left - snapshot.monitorRect.left;
+			const int dy = monitor->rect.top - snapshot.monitorRect.top;
+			rect = { rect.left + dx, rect.top + dy, rect.right + dx, rect.bottom + dy };
+		}
+	}
+
+	SetPresentState(snapshot.present);
+	BeginResizeHold();
+	const bool styleChanged = ApplyStyles(current, snapshot.state.style, snapshot.state.exStyle);
+	Mark(timeline, TRANSITION_STAGE_STYLE);
+	const WindowZOrder order = snapshot.state.style & BW_WS_CAPTION ? WindowZOrder::NoTopmost : WindowZOrder::Top;
+	ApplyPosition(current, order, rect, styleChanged);
+	EndResizeHold();
+	Mark(timeline, TRANSITION_STAGE_SET_POS);
+	if (snapshot.mode >= 0)
+		m_mode = snapshot.mode;
+	return true;
+}
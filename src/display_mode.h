@@ -0,0 +1,305 @@
+#pragma once
+#include "monitor_topology.h"
+#include "trace_writer.h"
+#include "transition_stats.h"
+#include "window_backend.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define PAYDAY2_WINDOWED_STYLE (BW_WS_CAPTION | BW_WS_VISIBLE | BW_WS_CLIPSIBLINGS | BW_WS_CLIPCHILDREN | BW_WS_SYSMENU | BW_WS_MINIMIZEBOX)
+#define PAYDAY2_WINDOWED_EX_STYLE BW_WS_EX_OVERLAPPEDWINDOW
+#define PAYDAY2_FULLSCREEN_WINDOWED_STYLE (BW_WS_POPUP | BW_WS_VISIBLE | BW_WS_CLIPSIBLINGS | BW_WS_CLIPCHILDREN)
+
+enum DisplayMode
+{
+	DISPLAY_MODE_FULLSCREEN = 0,
+	DISPLAY_MODE_WINDOWED = 1,
+	DISPLAY_MODE_FULLSCREEN_WINDOWED = 2
+};
+
+// How long FullscreenWindowed waits for the engine to finish its own reset before restyling.
+struct ReadinessOptions
+{
+	// Give up waiting after this long.
+	unsigned int timeoutMs;
+	// The window must be left alone by the engine for this long to count as settled.
+	unsigned int settleMs;
+	unsigned int pollMs;
+	// Restyle anyway when the timeout expires, otherwise the transition is dropped.
+	bool proceedOnTimeout;
+};
+
+struct ReadinessReport
+{
+	uint64_t lastWaitUs;
+	uint64_t maxWaitUs;
+	uint64_t totalWaitUs;
+	uint64_t waits;
+	uint64_t timeouts;
+	bool lastTimedOut;
+};
+
+// How many window system calls the reconciler issued versus skipped because the window was
+// already in the target state.
+struct ReconcileCounters
+{
+	uint64_t styleApplied;
+	uint64_t styleSkipped;
+	uint64_t exStyleApplied;
+	uint64_t exStyleSkipped;
+	uint64_t posApplied;
+	uint64_t posSkipped;
+	uint64_t frameChanges;
+};
+
+// Size notifications held back while the controller restyled the window, versus the WM_SIZE
+// messages that reached the engine.
+struct ResizeCounters
+{
+	uint64_t held;
+	uint64_t delivered;
+	// WM_SIZE messages the engine received since the last transition began, the final one
+	// included. One when the storm was coalesced.
+	uint64_t lastTransitionDelivered;
+	uint64_t transitions;
+};
+
+// Why a fullscreen windowed window cannot be promoted by DWM to independent flip, which is what
+// gives borderless the latency of exclusive fullscreen. Combined as bits.
+enum FlipBlocker
+{
+	FLIP_BLOCKER_NO_WINDOW = 1 << 0,
+	// The window is not exactly one monitor's rect, such as the whole virtual desktop.
+	FLIP_BLOCKER_MONITOR_RECT = 1 << 1,
+	// Caption, border or thick frame bits, or not a popup.
+	FLIP_BLOCKER_STYLE = 1 << 2,
+	// Layered, transparent or edge extended styles make DWM compose the window.
+	FLIP_BLOCKER_EX_STYLE = 1 << 3,
+	FLIP_BLOCKER_MINIMIZED = 1 << 4,
+	FLIP_BLOCKER_HIDDEN = 1 << 5,
+	FLIP_BLOCKER_COUNT = 6
+};
+
+const char* GetFlipBlockerName(int bit);
+// The blockers for a window in the given state, 0 when it qualifies.
+uint32_t CheckFlipEligibility(const WindowState& state, const MonitorTopologySnapshot& topology);
+
+struct FlipReport
+{
+	uint32_t blockers;
+	// The monitor the window was checked against, empty when none matched.
+	WindowRect monitor;
+	uint64_t checks;
+	uint64_t failures;
+	// The last fullscreen windowed transition asked for aspect or integer scaling and was
+	// stretched instead: the backdrop they need keeps the window from independent flip.
+	bool scalingStretched;
+};
+
+// How fullscreen windowed shows a render resolution below the monitor's.
+enum PresentScaling
+{
+	// The engine renders at the monitor's resolution.
+	PRESENT_SCALING_NONE = 0,
+	// The frame is stretched over the whole monitor.
+	PRESENT_SCALING_STRETCH,
+	// The largest size with the render aspect ratio, centred on black.
+	PRESENT_SCALING_ASPECT,
+	// The largest whole multiple of the render size, centred on black. Falls back to aspect when
+	// the render size does not fit the monitor.
+	PRESENT_SCALING_INTEGER,
+	PRESENT_SCALING_COUNT
+};
+
+// The rect the frame is presented to on the monitor.
+WindowRect ComputePresentRect(int width, int height, const WindowRect& monitor, int scaling);
+
+// Scaled fullscreen windowed. The engine is told its client area is the render size, so it
+// keeps rendering at that size, and windowed Direct3D scales the frame to the actual client
+// area on present. Only stretch covers the monitor, so only stretch keeps independent flip.
+struct PresentState
+{
+	// 0 when not scaled.
+	int renderWidth;
+	int renderHeight;
+	// The window does not cover the monitor, a black backdrop covers `monitor` behind it.
+	bool backdrop;
+	WindowRect monitor;
+
+	bool operator==(const PresentState& other) const
+	{
+		return renderWidth == other.renderWidth && renderHeight == other.renderHeight && backdrop == other.backdrop
+			&& (!backdrop || monitor == other.monitor);
+	}
+	bool operator!=(const PresentState& other) const { return !(*this == other); }
+};
+
+// A complete target display configuration, applied as one transition.
+struct DisplayConfig
+{
+	int mode;
+	// Client size in windowed mode.
+	int width = 0;
+	int height = 0;
+	int adapter = 0;
+	// Place the window's top-left corner at x, y relative to the monitor in windowed mode
+	// instead of centring it.
+	bool positioned = false;
+	int x = 0;
+	int y = 0;
+	// Fullscreen windowed renders at width x height and scales it on present, see
+	// PresentScaling. Ignored without a size.
+	int scaling = PRESENT_SCALING_NONE;
+};
+
+// Everything needed to put the window back exactly as it was before a transition.
+struct WindowSnapshot
+{
+	// Display mode the window was in, -1 when unknown.
+	int mode;
+	WindowState state;
+	// The monitor the window was on, empty when it was on none.
+	std::string monitorDevice;
+	WindowRect monitorRect;
+	PresentState present;
+};
+
+// Applies the display modes to the game window. All window system access goes through the
+// backend, so the same code runs in game and against the simulated backend.
+class DisplayModeController
+{
+public:
+	explicit DisplayModeController(WindowBackend& backend);
+
+	bool Attach();
+	// Attaches now if the game window exists, and again whenever the backend reports a new one.
+	// `attached` runs on the backend thread after each late attach of a window not seen before.
+	void WatchWindow(std::function<void()> attached = nullptr);
+	// Builds the monitor topology and keeps it current as displays change.
+	void RefreshMonitors();
+
+	WindowHandle GetWindow() const { return m_hWnd.load(); }
+	WindowBackend& GetBackend() const { return m_backend; }
+	MonitorTopology& GetTopology() { return m_topology; }
+	// Events go to the trace while it is started. Set before any transition runs.
+	void SetTrace(TraceWriter* trace) { m_trace = trace; }
+	TraceWriter* GetTrace() const { return m_trace; }
+
+	WindowRect GetMonitorRect(int adapter);
+	// Effective DPI of the adapter's monitor, BW_DEFAULT_DPI when unknown.
+	unsigned int GetAdapterDpi(int adapter);
+	// Puts the calling thread in the game window's DPI coordinate space, so its placement and
+	// monitor calls agree with the window. Before the window exists the thread becomes
+	// per-monitor aware instead, so a window it creates gets physical pixels on every monitor.
+	// Transitions and monitor refreshes call it on their own thread. Returns the awareness in
+	// effect, see DpiAwareness.
+	int MatchDpiAwareness();
+	int GetDpiAwareness() const { return m_dpiAwareness; }
+	// The timeline, when given, is marked as each stage of the transition finishes. Both return
+	// false when the transition could not be applied, see GetLastError.
+	bool Windowed(int width, int height, int adapter, TransitionTimeline* timeline = nullptr);
+	bool Windowed(const DisplayConfig& config, TransitionTimeline* timeline = nullptr);
+	bool FullscreenWindowed(int adapter, TransitionTimeline* timeline = nullptr);
+	bool FullscreenWindowed(const DisplayConfig& config, TransitionTimeline* timeline = nullptr);
+	// In this mode fullscreen windowed never covers the whole virtual desktop: an adapter
+	// without a known monitor falls back to the primary monitor. Every fullscreen windowed
+	// transition is then checked for independent flip eligibility before it touches the
+	// window, and one that would not qualify fails with the blockers in the report. A
+	// minimized window is deferred instead, see IsDeferred. Aspect and integer scaling fall
+	// back to stretch.
+	void SetFlipEnforced(bool enforced);
+	bool IsFlipEnforced() const { return m_flipEnforced; }
+	// Checks the window as it is now. Only reads the window.
+	FlipReport CheckFlip();
+	FlipReport GetFlipReport();
+	// Polls the window until the engine is done with it. Returns false on timeout.
+	bool WaitForEngineReady();
+
+	void SetReadinessOptions(const ReadinessOptions& options);
+	ReadinessOptions GetReadinessOptions();
+	ReadinessReport GetReadinessReport();
+	ReconcileCounters GetReconcileCounters();
+	ResizeCounters GetResizeCounters();
+	PresentState GetPresentState();
+	// Part of the game window's message hook. While the controller restyles and moves the window,
+	// every intermediate WM_WINDOWPOSCHANGED and WM_SIZE is swallowed, so the engine resizes its
+	// back buffer once for the final geometry instead of once per call. In scaled fullscreen
+	// windowed, a WM_SIZE is rewritten to the render size. Returns true to swallow.
+	bool FilterMessage(WindowMessage& message);
+	// Last style, extended style and rect the controller applied or found already in place.
+	bool GetLastApplied(WindowState& state);
+
+	// Returns false for an unknown mode or a failed transition. Mode 0 is handled by the engine
+	// itself.
+	bool ChangeDisplayMode(int mode, int width, int height, int adapter, TransitionTimeline* timeline = nullptr);
+	// Same as ChangeDisplayMode, with the window position included. Every part of the
+	// configuration lands in a single restyle and SetWindowPos.
+	bool ApplyDisplayConfig(const DisplayConfig& config, TransitionTimeline* timeline = nullptr);
+	// The mode of the last successful ChangeDisplayMode, -1 before the first.
+	int GetMode() const { return m_mode; }
+	// Why the last ChangeDisplayMode or Restore failed. Only meaningful on the thread that ran it.
+	const std::string& GetLastError() const { return m_lastError; }
+	// The last transition failed on something transient and left the window untouched, so it
+	// can be run again once that clears. Same thread rule as GetLastError.
+	bool IsDeferred() const { return m_deferred; }
+
+	// Only reads the window, so it is safe to call from the game thread while the worker runs.
+	bool CaptureSnapshot(WindowSnapshot& snapshot);
+	// Puts the window back as captured in one restyle, with no recomputation from settings.
+	bool Restore(const WindowSnapshot& snapshot, TransitionTimeline* timeline = nullptr);
+
+private:
+	// Only the calls whose target differs from the window's current state are issued, and the
+	// frame is only recalculated when a style actually changed. `current` is null when the
+	// window state could not be read, in which case everything is applied.
+	bool ApplyStyles(const WindowState* current, uint32_t style, uint32_t exStyle);
+	void ApplyPosition(const WindowState* current, WindowZOrder order, const WindowRect& rect, bool frameChanged);
+	const WindowState* ReadWindowState(WindowState& state);
+	// Revalidates the cached handle before a transition, looking the window up again only when
+	// it was destroyed.
+	bool EnsureWindow();
+	int MatchThreadDpiAwareness();
+	// Bracket the restyle and move of a transition. The end posts the engine a single WM_SIZE
+	// when anything was held back, preceded by a WM_MOVE when the window may have moved.
+	void BeginResizeHold();
+	void EndResizeHold();
+	// Held and released messages go on the window track, the engine never sees the held ones.
+	void TraceResizeMessage(const char* name, const char* action, const WindowRect& rect);
+	bool Fail(const char* error);
+	bool Defer(const char* error);
+	// Checks the given state, null for no window, and records the result in the flip report.
+	FlipReport RecordFlipCheck(const WindowState* state);
+	// Shows or hides the backdrop as needed. Returns true when anything changed.
+	bool SetPresentState(const PresentState& present);
+	// Fullscreen windowed target, following the flip enforcement for an unknown adapter.
+	WindowRect GetFullscreenRect(int adapter);
+
+	WindowBackend& m_backend;
+	// Set from the backend thread when the window shows up late.
+	std::atomic<WindowHandle> m_hWnd;
+	MonitorTopology m_topology;
+	TraceWriter* m_trace;
+	std::atomic<int> m_mode;
+	std::atomic<int> m_dpiAwareness;
+	std::string m_lastError;
+	bool m_deferred;
+
+	// Options are set and reports read from the game thread while the worker runs.
+	std::mutex m_mutex;
+	ReadinessOptions m_readinessOptions;
+	ReadinessReport m_readinessReport;
+	ReconcileCounters m_reconcileCounters;
+	ResizeCounters m_resizeCounters;
+	bool m_holdingResizes;
+	bool m_resizesHeld;
+	// A held WM_WINDOWPOSCHANGED may have moved the window.
+	bool m_movesHeld;
+	std::atomic<bool> m_flipEnforced;
+	FlipReport m_flipReport;
+	PresentState m_present;
+	WindowState m_lastApplied;
+	bool m_hasApplied;
+};
@@ -0,0 +1,92 @@
+#include "focus_filter.h"
+
+FocusFilter::FocusFilter(DisplayModeController& controller)
+	: m_controller(controller), m_enabled(true), m_deactivated(false), m_returning(false), m_returnFiltered(false), m_activatedAt(0), m_stats()
+{
+}
+
+void FocusFilter::SetEnabled(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_enabled = enabled;
+}
+
+bool FocusFilter::IsEnabled()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_enabled;
+}
+
+void FocusFilter::OnFrame(uint64_t now)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_returning)
+		return;
+	m_returning = false;
+	(m_returnFiltered ? m_stats.filtered : m_stats.unfiltered).Add(now - m_activatedAt);
+}
+
+AltTabStats FocusFilter::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void FocusFilter::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats = AltTabStats();
+}
+
+bool FocusFilter::OnMessage(const WindowMessage& message)
+{
+	const uint64_t now = m_controller.GetBackend().GetTime();
+	const char* name = nullptr;
+	bool suppress = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const bool filtering = m_enabled && m_controller.GetMode() == DISPLAY_MODE_FULLSCREEN_WINDOWED;
+		switch (message.type)
+		{
+		case WINDOW_MESSAGE_ACTIVATE_APP:
+			name = "WM_ACTIVATEAPP";
+			if (message.active)
+			{
+				m_returning = true;
+				m_returnFiltered = m_deactivated;
+				m_activatedAt = now;
+				// The game never saw it leave, so it must not see it come back either.
+				suppress = m_deactivated;
+				m_deactivated = false;
+			}
+			else if (filtering)
+			{
+				m_deactivated = true;
+				suppress = true;
+			}
+			break;
+		case WINDOW_MESSAGE_SIZE:
+			name = "WM_SIZE";
+			suppress = message.minimized && m_deactivated;
+			break;
+		case WINDOW_MESSAGE_WINDOW_POS_CHANGED:
+		case WINDOW_MESSAGE_MOVE:
+			break;
+		case WINDOW_MESSAGE_MINIMIZE_COMMAND:
+			name = "WM_SYSCOMMAND";
+			suppress = m_deactivated;
+			break;
+		}
+		if (suppress)
+			m_stats.suppressed++;
+	}
+	TraceMessage(name, now, suppress);
+	return suppress;
+}
+
+void FocusFilter::TraceMessage(const char* name, uint64_t now, bool suppressed)
+{
+	TraceWriter* trace = m_controller.GetTrace();
+	if (name && trace && trace->IsEnabled())
+		trace->Instant(TRACE_THREAD_GAME, "message", name, now, suppressed ? "\"suppressed\":true" : "\"suppressed\":false");
+}
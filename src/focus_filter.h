@@ -0,0 +1,48 @@
+#pragma once
+#include "display_mode.h"
+#include "transition_stats.h"
+#include <mutex>
+
+struct AltTabStats
+{
+	// Time from the game being activated again until its next frame, split by whether the
+	// filter was handling the switch.
+	DurationStats filtered;
+	DurationStats unfiltered;
+	// Messages kept from the game.
+	uint64_t suppressed;
+};
+
+// In fullscreen windowed the engine still treats losing focus like losing an exclusive display:
+// it minimises and resets its device on WM_ACTIVATEAPP, which is exactly the slow alt-tab that
+// borderless is meant to avoid. This hooks the game window and, in that mode only, keeps the
+// deactivation and the minimise that would follow it from the game. WM_ACTIVATE still goes
+// through, so the game releases the cursor and input as usual.
+class FocusFilter
+{
+public:
+	explicit FocusFilter(DisplayModeController& controller);
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+	// Called once per frame on the game thread, it closes the alt-tab measurement.
+	void OnFrame(uint64_t now);
+	AltTabStats GetStats();
+	void ResetStats();
+
+	// Part of the game window's message hook. Returns true to keep the message from the game.
+	bool OnMessage(const WindowMessage& message);
+
+private:
+	void TraceMessage(const char* name, uint64_t now, bool suppressed);
+
+	DisplayModeController& m_controller;
+	std::mutex m_mutex;
+	bool m_enabled;
+	// A deactivation was kept from the game, which therefore still believes it is active.
+	bool m_deactivated;
+	bool m_returning;
+	bool m_returnFiltered;
+	uint64_t m_activatedAt;
+	AltTabStats m_stats;
+};
@@ -0,0 +1,91 @@
+#include "frame_benchmark.h"
+#include <cstdio>
+
+FrameBenchmark::FrameBenchmark()
+	: m_state(STATE_IDLE), m_options(), m_originalMode(-1), m_index(0), m_settleStart(0), m_last(0)
+{
+}
+
+bool FrameBenchmark::Start(const FrameBenchmarkOptions& options, int originalMode)
+{
+	if (IsRunning() || options.modes.empty() || options.frames == 0)
+		return false;
+	m_options = options;
+	m_originalMode = originalMode;
+	m_index = 0;
+	m_intervals.clear();
+	m_results.clear();
+	m_state = STATE_SWITCH;
+	return true;
+}
+
+void FrameBenchmark::Cancel()
+{
+	if (IsRunning())
+		m_state = STATE_IDLE;
+}
+
+int FrameBenchmark::Tick(uint64_t now)
+{
+	switch (m_state)
+	{
+	case STATE_SWITCH:
+		m_state = STATE_SETTLE;
+		m_settleStart = now;
+		return m_options.modes[m_index];
+	case STATE_SETTLE:
+		if (now - m_settleStart >= m_options.settleMs * 1000ull)
+		{
+			m_state = STATE_CAPTURE;
+			m_last = now;
+			m_intervals.clear();
+		}
+		return -1;
+	case STATE_CAPTURE:
+		m_intervals.push_back((uint32_t)(now - m_last));
+		m_last = now;
+		if (m_intervals.size() < m_options.frames)
+			return -1;
+		m_results.push_back({ m_options.modes[m_index], ComputeFrameStats(m_intervals) });
+		if (++m_index < m_options.modes.size())
+		{
+			m_state = STATE_SETTLE;
+			m_settleStart = now;
+			return m_options.modes[m_index];
+		}
+		m_state = STATE_DONE;
+		return m_originalMode != m_options.modes.back() ? m_originalMode : -1;
+	default:
+		return -1;
+	}
+}
+
+int FrameBenchmark::GetBestMode() const
+{
+	const FrameBenchmarkResult* best = nullptr;
+	for (const FrameBenchmarkResult& result : m_results)
+	{
+		if (!best || result.stats.p99Us < best->stats.p99Us)
+			best = &result;
+	}
+	return best ? best->mode : -1;
+}
+
+std::string FrameBenchmark::FormatReport() const
+{
+	std::string report;
+	char line[160];
+	std::snprintf(line, sizeof(line), "%-6s %8s %9s %9s %9s %9s %9s %9s\n", "mode", "frames", "mean_ms", "p50_ms", "p95_ms", "p99_ms", "max_ms", "stutters");
+	report += line;
+	for (const FrameBenchmarkResult& result : m_results)
+	{
+		const FrameStats& stats = result.stats;
+		std::snprintf(line, sizeof(line), "%-6d %8llu %9.2f %9.2f %9.2f %9.2f %9.2f %9llu\n", result.mode, (unsigned long long)stats.frames,
+			stats.meanUs / 1000.0, stats.p50Us / 1000.0, stats.p95Us / 1000.0, stats.p99Us / 1000.0, stats.maxUs / 1000.0,
+			(unsigned long long)stats.stutters);
+		report += line;
+	}
+	std::snprintf(line, sizeof(line), "best mode by p99: %d\n", GetBestMode());
+	report += line;
+	return report;
+}
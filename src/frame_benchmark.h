@@ -0,0 +1,65 @@
+#pragma once
+#include "frame_timer.h"
+#include <string>
+#include <vector>
+
+struct FrameBenchmarkOptions
+{
+	// Display modes to measure, in order.
+	std::vector<int> modes;
+	// Frames captured per mode.
+	unsigned int frames;
+	// Time given to each switch, including the engine's reset, before capturing starts.
+	unsigned int settleMs;
+};
+
+struct FrameBenchmarkResult
+{
+	int mode;
+	FrameStats stats;
+};
+
+// Cycles through display modes and captures the same number of frames in each, so the modes
+// can be compared on one machine. It only decides what happens when; switching modes is left
+// to the caller, which has to go through the game like the menu does. Driven once per frame
+// from the game thread and not thread safe.
+class FrameBenchmark
+{
+public:
+	FrameBenchmark();
+
+	// `originalMode` is switched back to once every mode has been measured, unless it is -1.
+	// Returns false when a run is already in progress or there is nothing to measure.
+	bool Start(const FrameBenchmarkOptions& options, int originalMode);
+	void Cancel();
+	// Advances by one frame, `now` in microseconds. Returns the display mode to switch to
+	// before the next frame, or -1.
+	int Tick(uint64_t now);
+
+	bool IsRunning() const { return m_state != STATE_IDLE && m_state != STATE_DONE; }
+	bool IsFinished() const { return m_state == STATE_DONE; }
+	const std::vector<FrameBenchmarkResult>& GetResults() const { return m_results; }
+	// The mode with the lowest 99th percentile frame time, -1 before any result.
+	int GetBestMode() const;
+	// Plain text comparison table of the results.
+	std::string FormatReport() const;
+
+private:
+	enum State
+	{
+		STATE_IDLE,
+		STATE_SWITCH,
+		STATE_SETTLE,
+		STATE_CAPTURE,
+		STATE_DONE
+	};
+
+	State m_state;
+	FrameBenchmarkOptions m_options;
+	int m_originalMode;
+	size_t m_index;
+	uint64_t m_settleStart;
+	uint64_t m_last;
+	std::vector<uint32_t> m_intervals;
+	std::vector<FrameBenchmarkResult> m_results;
+};
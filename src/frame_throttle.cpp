@@ -0,0 +1,55 @@
+#include "frame_throttle.h"
+#include <algorithm>
+
+FrameThrottle::FrameThrottle(WindowBackend& backend)
+	: m_backend(backend), m_capFps(0), m_lastFrame(0), m_stats()
+{
+}
+
+void FrameThrottle::SetCap(unsigned int fps)
+{
+	m_capFps = fps;
+}
+
+void FrameThrottle::OnFrame(WindowHandle window)
+{
+	const unsigned int cap = m_capFps;
+	const uint64_t start = m_backend.GetTime();
+	const bool throttle = cap && window && !m_backend.IsForegroundWindow(window) && !IsBusy();
+	uint64_t now = start;
+	if (throttle)
+	{
+		const uint64_t due = m_lastFrame + 1000000 / cap;
+		while (now < due && !m_backend.IsForegroundWindow(window) && !IsBusy())
+		{
+			m_backend.Sleep((unsigned int)std::min<uint64_t>((due - now + 999) / 1000, kPollMs));
+			now = m_backend.GetTime();
+		}
+	}
+	m_lastFrame = now;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.active = throttle;
+	if (throttle)
+	{
+		m_stats.throttledUs += now - start;
+		m_stats.throttledFrames++;
+	}
+}
+
+bool FrameThrottle::IsBusy() const
+{
+	return m_busy && m_busy();
+}
+
+FrameThrottleStats FrameThrottle::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void FrameThrottle::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats = FrameThrottleStats();
+}
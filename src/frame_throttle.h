@@ -0,0 +1,50 @@
+#pragma once
+#include "window_backend.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+struct FrameThrottleStats
+{
+	// Time the game thread spent sleeping in the background.
+	uint64_t throttledUs;
+	uint64_t throttledFrames;
+	// The last frame was throttled.
+	bool active;
+};
+
+// Caps the frame rate while the game window is not in the foreground, so a borderless or
+// windowed game that was alt-tabbed away from stops taking CPU and GPU time from whatever the
+// user switched to. The wait is polled in short slices and ends the moment the window is in the
+// foreground again.
+class FrameThrottle
+{
+public:
+	// Longest single sleep while waiting, which bounds how late focus is noticed.
+	static const unsigned int kPollMs = 10;
+
+	explicit FrameThrottle(WindowBackend& backend);
+
+	// Frames per second in the background, 0 to never throttle.
+	void SetCap(unsigned int fps);
+	unsigned int GetCap() const { return m_capFps; }
+	// Polled before each sleep slice; no frame waits while it returns true. Meant for a transition
+	// in flight: SetWindowPos from another thread blocks until the window thread handles its
+	// messages, which it cannot do asleep. Set before the first frame.
+	void SetBusyCheck(std::function<bool()> busy) { m_busy = busy; }
+	// Called once per frame on the game thread, after the frame's own work.
+	void OnFrame(WindowHandle window);
+	FrameThrottleStats GetStats();
+	void ResetStats();
+
+private:
+	bool IsBusy() const;
+
+	WindowBackend& m_backend;
+	std::atomic<unsigned int> m_capFps;
+	std::function<bool()> m_busy;
+	// Game thread only.
+	uint64_t m_lastFrame;
+	std::mutex m_mutex;
+	FrameThrottleStats m_stats;
+};
@@ -0,0 +1,67 @@
+#include "frame_timer.h"
+#include "transition_stats.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+FrameTimer::FrameTimer()
+	: m_written(0), m_start(0), m_last(0)
+{
+	for (std::atomic<uint32_t>& interval : m_intervals)
+		interval.store(0, std::memory_order_relaxed);
+}
+
+void FrameTimer::Tick(uint64_t now)
+{
+	const uint64_t last = m_last;
+	m_last = now;
+	if (!last)
+		return;
+	const uint64_t interval = std::min<uint64_t>(now - last, UINT32_MAX);
+	const uint64_t written = m_written.load(std::memory_order_relaxed);
+	m_intervals[written % kCapacity].store((uint32_t)interval, std::memory_order_relaxed);
+	m_written.store(written + 1, std::memory_order_release);
+}
+
+void FrameTimer::Reset()
+{
+	m_start.store(m_written.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+void FrameTimer::GetIntervals(std::vector<uint32_t>& intervals) const
+{
+	const uint64_t written = m_written.load(std::memory_order_acquire);
+	const uint64_t start = std::max(m_start.load(std::memory_order_acquire), written > kCapacity ? written - kCapacity : 0);
+	intervals.clear();
+	intervals.reserve((size_t)(written - start));
+	for (uint64_t i = start; i < written; i++)
+		intervals.push_back(m_intervals[i % kCapacity].load(std::memory_order_relaxed));
+}
+
+FrameStats ComputeFrameStats(std::vector<uint32_t> intervals, uint64_t stutterThresholdUs)
+{
+	FrameStats stats = {};
+	if (intervals.empty())
+		return stats;
+
+	uint64_t total = 0;
+	for (uint32_t interval : intervals)
+		total += interval;
+	std::sort(intervals.begin(), intervals.end());
+	stats.frames = intervals.size();
+	stats.meanUs = total / intervals.size();
+	stats.p50Us = Percentile(intervals, 50);
+	stats.p95Us = Percentile(intervals, 95);
+	stats.p99Us = Percentile(intervals, 99);
+	stats.maxUs = intervals.back();
+	stats.stutterThresholdUs = stutterThresholdUs ? stutterThresholdUs : stats.p50Us * 2;
+	stats.stutters = intervals.end() - std::upper_bound(intervals.begin(), intervals.end(), stats.stutterThresholdUs);
+	return stats;
+}
+
+FrameStats FrameTimer::GetStats(uint64_t stutterThresholdUs) const
+{
+	std::vector<uint32_t> intervals;
+	GetIntervals(intervals);
+	return ComputeFrameStats(std::move(intervals), stutterThresholdUs);
+}
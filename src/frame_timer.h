@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct FrameStats
+{
+	uint64_t frames;
+	uint64_t meanUs;
+	uint64_t p50Us;
+	uint64_t p95Us;
+	uint64_t p99Us;
+	uint64_t maxUs;
+	// Frames longer than the stutter threshold.
+	uint64_t stutters;
+	uint64_t stutterThresholdUs;
+};
+
+// A threshold of 0 counts frames longer than twice the median as stutters.
+FrameStats ComputeFrameStats(std::vector<uint32_t> intervals, uint64_t stutterThresholdUs = 0);
+
+// Intervals between consecutive Plugin_Update calls, kept for the last kCapacity frames. Tick is
+// called from the game thread only; the buffer can be read from any thread without blocking it.
+// A reader racing a writer that laps it may see a few newer intervals, which is harmless for
+// statistics.
+class FrameTimer
+{
+public:
+	static const size_t kCapacity = 4096;
+
+	FrameTimer();
+
+	// `now` in microseconds.
+	void Tick(uint64_t now);
+	// Forgets every interval recorded so far.
+	void Reset();
+	// Copies the recorded intervals, oldest first.
+	void GetIntervals(std::vector<uint32_t>& intervals) const;
+	// A threshold of 0 counts frames longer than twice the median as stutters.
+	FrameStats GetStats(uint64_t stutterThresholdUs = 0) const;
+
+private:
+	std::atomic<uint32_t> m_intervals[kCapacity];
+	// Total intervals ever written, and the count at the last Reset.
+	std::atomic<uint64_t> m_written;
+	std::atomic<uint64_t> m_start;
+	uint64_t m_last;
+};
@@ -0,0 +1,31 @@
+#include "localization.h"
+
+static const LocalizedString kStrings[] = {
+#include "localization_bundle.inc"
+};
+
+static const char* const kFallbackLanguage = "english";
+
+std::vector<LocalizedString> GetLocalizedStrings(const std::string& language)
+{
+	std::vector<LocalizedString> strings;
+	for (const LocalizedString& string : kStrings)
+	{
+		if (language == string.language)
+			strings.push_back(string);
+	}
+	if (strings.empty() && language != kFallbackLanguage)
+		return GetLocalizedStrings(kFallbackLanguage);
+	return strings;
+}
+
+std::vector<std::string> GetLocalizationLanguages()
+{
+	std::vector<std::string> languages;
+	for (const LocalizedString& string : kStrings)
+	{
+		if (languages.empty() || languages.back() != string.language)
+			languages.push_back(string.language);
+	}
+	return languages;
+}
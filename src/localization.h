@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct LocalizedString
+{
+	const char* language;
+	const char* key;
+	// UTF-8.
+	const char* text;
+};
+
+// The strings of lua/loc/*.json, packed into the module at build time so the game never probes
+// or parses the files. Languages without a translation get the English strings.
+std::vector<LocalizedString> GetLocalizedStrings(const std::string& language);
+std::vector<std::string> GetLocalizationLanguages();
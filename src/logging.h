@@ -0,0 +1,12 @@
+#pragma once
+
+// The core logs through the SuperBLT macros. Outside the game (the Linux build) there is no
+// SuperBLT to load the module, so the same macros write to stderr instead.
+#ifdef _WIN32
+#include <superblt_flat.h>
+#else
+#include <cstdio>
+#define PD2HOOK_LOG_LOG(msg) std::fprintf(stderr, "[LOG] %s\n", (const char*)(msg))
+#define PD2HOOK_LOG_WARN(msg) std::fprintf(stderr, "[WARN] %s\n", (const char*)(msg))
+#define PD2HOOK_LOG_ERROR(msg) std::fprintf(stderr, "[ERROR] %s\n", (const char*)(msg))
+#endif
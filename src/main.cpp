@@ -1,99 +1,867 @@
 #include <superblt_flat.h>
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#include <thread>
-#include <vector>
+#include "display_mode.h"
+#include "focus_filter.h"
+#include "frame_benchmark.h"
+#include "frame_throttle.h"
+#include "frame_timer.h"
+#include "localization.h"
+#include "settings_store.h"
+#include "transition_worker.h"
+#include "win32_backend.h"
+#include <fstream>
 
-HWND g_hWnd;
-std::vector<HMONITOR> g_hMonitors;
+Win32Backend g_backend;
+DisplayModeController g_controller(g_backend);
+FocusFilter g_focusFilter(g_controller);
+// Never destroyed: the worker lives as long as the game process, and joining it during DLL
+// unload would happen under the loader lock.
+TransitionWorker* g_worker = new TransitionWorker(g_controller);
+// Plugin_Init runs before Lua, so it reads the settings from SuperBLT's default SavePath; Lua
+// passes its actual SavePath to get_settings. Leaked like the worker for the same reason.
+SettingsStore* g_settings = new SettingsStore("mods/saves/FullscreenWindowed.json");
+// Leaked like the worker, its flush thread must not be joined during DLL unload.
+TraceWriter* g_trace = new TraceWriter();
+FrameTimer g_frameTimer;
+FrameThrottle g_frameThrottle(g_backend);
+uint64_t g_lastFrame = 0;
+// The game window the message hook and the saved mode were set up for. Game thread only.
+WindowHandle g_setupWindow = nullptr;
+FrameBenchmark g_frameBenchmark;
+std::string g_frameBenchmarkReportPath;
 
-#define PAYDAY2_WINDOWED_STYLE (WS_CAPTION | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | WS_SYSMENU | WS_MINIMIZEBOX)
-#define PAYDAY2_FULLSCREEN_WINDOWED_STYLE (WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN)
+// A Lua function kept in the registry between frames. The ref is 0 when there is none.
+struct LuaCallback
+{
+	lua_State* state;
+	int ref;
+};
+
+LuaCallback g_transitionCallback = {};
+// Switches the display mode for the frame benchmark.
+LuaCallback g_benchmarkCallback = {};
 
-RECT GetMonitorRect(int adapter)
+// Returns the request id passed to the transition callback once it has run, or nil.
+int ChangeDisplayMode(lua_State* L)
 {
-	if (adapter < g_hMonitors.size())
+	int mode = luaL_checkint(L, 1);
+	int width = luaL_checkint(L, 2);
+	int height = luaL_checkint(L, 3);
+	int adapter = luaL_checkint(L, 4);
+	switch (mode)
 	{
-		MONITORINFO info;
-		info.cbSize = sizeof(MONITORINFO);
-		if (GetMonitorInfo(g_hMonitors[adapter], &info))
-			return info.rcMonitor;
+	case DISPLAY_MODE_FULLSCREEN:
+	case DISPLAY_MODE_WINDOWED:
+	case DISPLAY_MODE_FULLSCREEN_WINDOWED:
+		// Fullscreen is applied by the engine, but it still replaces any pending request.
+		lua_pushnumber(L, (lua_Number)g_worker->Submit({ mode, width, height, adapter }));
+		return 1;
+	default:
+		PD2HOOK_LOG_ERROR("Invalid parameter");
 	}
-	RECT rect;
-	GetWindowRect(GetDesktopWindow(), &rect);
-	return rect;
+	return 0;
 }
 
-void Windowed(int width, int height, int adapter)
+static bool GetIntField(lua_State* L, int index, const char* name, int& value)
 {
-	SetWindowLong(g_hWnd, GWL_STYLE, PAYDAY2_WINDOWED_STYLE);
-	SetWindowLong(g_hWnd, GWL_EXSTYLE, WS_EX_OVERLAPPEDWINDOW);
-	RECT rect{ 0, 0, width, height };
-	AdjustWindowRectEx(&rect, PAYDAY2_WINDOWED_STYLE, FALSE, WS_EX_OVERLAPPEDWINDOW);
-	const int window_width = rect.right - rect.left;
-	const int window_height = rect.bottom - rect.top;
-	rect = GetMonitorRect(adapter);
-	const int screen_width = rect.right - rect.left;
-	const int screen_height = rect.bottom - rect.top;
-	if (screen_width >= window_width)
-		rect.left = (screen_width - window_width) / 2;
-	if (screen_height >= window_height)
-		rect.top = (screen_height - window_height) / 2;
-	SetWindowPos(g_hWnd, HWND_NOTOPMOST, rect.left, rect.top, window_width, window_height, SWP_FRAMECHANGED);
+	lua_getfield(L, index, name);
+	const bool present = !lua_isnoneornil(L, -1);
+	if (present)
+		value = (int)lua_tointeger(L, -1);
+	lua_pop(L, 1);
+	return present;
 }
 
-void FullscreenWindowed(int adapter)
+// Reads the value on top of the stack as one of DisplayMode, raising a Lua error naming `what`
+// for anything else.
+static int CheckDisplayMode(lua_State* L, const char* what)
 {
-	Sleep(100);
-	SetWindowLong(g_hWnd, GWL_STYLE, PAYDAY2_FULLSCREEN_WINDOWED_STYLE);
-	SetWindowLong(g_hWnd, GWL_EXSTYLE, 0);
-	RECT rect = GetMonitorRect(adapter);
-	SetWindowPos(g_hWnd, 0, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top, SWP_FRAMECHANGED);
+	const lua_Number value = lua_tonumber(L, -1);
+	const int mode = (int)value;
+	if (!lua_isnumber(L, -1) || (lua_Number)mode != value
+		|| (mode != DISPLAY_MODE_FULLSCREEN && mode != DISPLAY_MODE_WINDOWED && mode != DISPLAY_MODE_FULLSCREEN_WINDOWED))
+		return luaL_error(L, "%s must be a display mode: 0, 1 or 2", what);
+	return mode;
 }
 
-int ChangeDisplayMode(lua_State* L)
+// Takes the whole target configuration in one table, { mode, width, height, adapter, x, y,
+// scaling }, and applies it as a single transition. Without x and y the window is centred. With
+// scaling, fullscreen windowed renders at width x height, see PresentScaling. Returns the request
+// id like change_display_mode.
+int ApplyDisplayConfig(lua_State* L)
 {
-	int mode = luaL_checkint(L, 1);
-	int width = luaL_checkint(L, 2);
-	int height = luaL_checkint(L, 3);
-	int adapter = luaL_checkint(L, 4);
-	switch (mode)
+	if (!lua_istable(L, 1))
+		return luaL_error(L, "apply_display_config expects a table");
+	TransitionRequest request = {};
+	if (!GetIntField(L, 1, "mode", request.mode) || !GetIntField(L, 1, "width", request.width) || !GetIntField(L, 1, "height", request.height))
+		return luaL_error(L, "apply_display_config needs mode, width and height");
+	GetIntField(L, 1, "adapter", request.adapter);
+	const bool hasX = GetIntField(L, 1, "x", request.x);
+	const bool hasY = GetIntField(L, 1, "y", request.y);
+	request.positioned = hasX && hasY;
+	GetIntField(L, 1, "scaling", request.scaling);
+	switch (request.mode)
 	{
-	case 0:
-		break;
-	case 1:
-		std::thread(Windowed, width, height, adapter).detach();
-		break;
-	case 2:
-		std::thread(FullscreenWindowed, adapter).detach();
-		break;
+	case DISPLAY_MODE_FULLSCREEN:
+	case DISPLAY_MODE_WINDOWED:
+	case DISPLAY_MODE_FULLSCREEN_WINDOWED:
+		lua_pushnumber(L, (lua_Number)g_worker->Submit(request));
+		return 1;
 	default:
 		PD2HOOK_LOG_ERROR("Invalid parameter");
 	}
 	return 0;
 }
 
-BOOL CALLBACK MonitorEnumProcCallback(HMONITOR hMonitor, HDC hdc, LPRECT lprcMonitor, LPARAM dwData)
+int NoteRenderSettingsApplied(lua_State* L)
+{
+	g_worker->NoteRenderSettingsApplied();
+	return 0;
+}
+
+// The request id to wait for before capturing the window, or nil when nothing is in flight.
+int GetActiveTransition(lua_State* L)
+{
+	const uint64_t id = g_worker->GetActiveRequest();
+	if (id)
+		lua_pushnumber(L, (lua_Number)id);
+	else
+		lua_pushnil(L);
+	return 1;
+}
+
+int BeginTransition(lua_State* L)
+{
+	const int id = g_worker->BeginTransaction();
+	if (id)
+		lua_pushinteger(L, id);
+	else
+		lua_pushnil(L);
+	return 1;
+}
+
+int CommitTransition(lua_State* L)
+{
+	lua_pushboolean(L, g_worker->CommitTransaction(luaL_checkint(L, 1)));
+	return 1;
+}
+
+int RollbackTransition(lua_State* L)
+{
+	lua_pushboolean(L, g_worker->RollbackTransaction(luaL_checkint(L, 1)));
+	return 1;
+}
+
+static void ReleaseCallback(LuaCallback& callback)
+{
+	if (callback.ref && is_active_state(callback.state))
+		luaL_unref(callback.state, LUA_REGISTRYINDEX, callback.ref);
+	callback.state = nullptr;
+	callback.ref = 0;
+}
+
+static void SetCallback(LuaCallback& callback, lua_State* L, int index)
+{
+	ReleaseCallback(callback);
+	lua_pushvalue(L, index);
+	callback.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	callback.state = L;
+}
+
+// Pushes the function and returns its state, or null when there is none.
+static lua_State* PushCallback(LuaCallback& callback)
+{
+	if (!callback.ref)
+		return nullptr;
+	if (!is_active_state(callback.state))
+	{
+		// The state was closed by a reload; its registry went with it.
+		callback.state = nullptr;
+		callback.ref = 0;
+		return nullptr;
+	}
+	lua_rawgeti(callback.state, LUA_REGISTRYINDEX, callback.ref);
+	return callback.state;
+}
+
+static void CallCallback(lua_State* L, int args)
+{
+	if (lua_pcall(L, args, 0, 0) != 0)
+	{
+		PD2HOOK_LOG_ERROR(lua_tostring(L, -1));
+		lua_pop(L, 1);
+	}
+}
+
+// Sets the function called from the game thread with each transition's result, or clears it
+// when given nil.
+int SetTransitionCallback(lua_State* L)
+{
+	if (!lua_isnoneornil(L, 1) && !lua_isfunction(L, 1))
+		return luaL_error(L, "set_transition_callback expects a function or nil");
+	if (lua_isfunction(L, 1))
+		SetCallback(g_transitionCallback, L, 1);
+	else
+		ReleaseCallback(g_transitionCallback);
+	return 0;
+}
+
+// Returns the menu strings for a language name like "english", falling back to English, and
+// the list of languages that have a translation.
+int GetLocalizedStringsLua(lua_State* L)
+{
+	const std::vector<LocalizedString> strings = GetLocalizedStrings(luaL_checkstring(L, 1));
+	lua_createtable(L, 0, (int)strings.size());
+	for (const LocalizedString& string : strings)
+	{
+		lua_pushstring(L, string.text);
+		lua_setfield(L, -2, string.key);
+	}
+	const std::vector<std::string> languages = GetLocalizationLanguages();
+	lua_createtable(L, (int)languages.size(), 0);
+	for (size_t i = 0; i < languages.size(); i++)
+	{
+		lua_pushstring(L, languages[i].c_str());
+		lua_rawseti(L, -2, (int)i + 1);
+	}
+	return 2;
+}
+
+// Takes the settings file path, which moves the store there when it differs. Returns the
+// settings table and whether there were any, from the file or saved since.
+int GetSettings(lua_State* L)
+{
+	const char* path = luaL_optstring(L, 1, nullptr);
+	if (path && g_settings->GetPath() != path)
+		g_settings->Reopen(path);
+	const std::map<std::string, double> values = g_settings->GetAll();
+	lua_newtable(L);
+	for (const auto& value : values)
+	{
+		lua_pushnumber(L, value.second);
+		lua_setfield(L, -2, value.first.c_str());
+	}
+	lua_pushboolean(L, !values.empty());
+	return 2;
+}
+
+// SuperBLT has no unload hook, so Lua calls this as the game quits. Stops the settings thread
+// and writes what it had not saved yet; later changes stay in memory.
+int StopSettings(lua_State* L)
+{
+	g_settings->Stop();
+	return 0;
+}
+
+// Only updates memory; the file is written later from the settings thread.
+int SetSetting(lua_State* L)
+{
+	const char* key = luaL_checkstring(L, 1);
+	g_settings->Set(key, luaL_checknumber(L, 2));
+	return 0;
+}
+
+int SetReadinessOptions(lua_State* L)
+{
+	ReadinessOptions options = g_controller.GetReadinessOptions();
+	options.timeoutMs = luaL_checkint(L, 1);
+	options.settleMs = luaL_optint(L, 2, options.settleMs);
+	if (!lua_isnoneornil(L, 3))
+		options.proceedOnTimeout = lua_toboolean(L, 3) != 0;
+	g_controller.SetReadinessOptions(options);
+	return 0;
+}
+
+int GetReadinessReport(lua_State* L)
+{
+	const ReadinessReport report = g_controller.GetReadinessReport();
+	lua_newtable(L);
+	lua_pushnumber(L, report.lastWaitUs / 1000.0);
+	lua_setfield(L, -2, "last_wait_ms");
+	lua_pushnumber(L, report.maxWaitUs / 1000.0);
+	lua_setfield(L, -2, "max_wait_ms");
+	lua_pushnumber(L, report.waits ? report.totalWaitUs / 1000.0 / report.waits : 0.0);
+	lua_setfield(L, -2, "mean_wait_ms");
+	lua_pushnumber(L, (lua_Number)report.waits);
+	lua_setfield(L, -2, "waits");
+	lua_pushnumber(L, (lua_Number)report.timeouts);
+	lua_setfield(L, -2, "timeouts");
+	lua_pushboolean(L, report.lastTimedOut);
+	lua_setfield(L, -2, "last_timed_out");
+	return 1;
+}
+
+int GetReconcileStats(lua_State* L)
+{
+	const ReconcileCounters counters = g_controller.GetReconcileCounters();
+	lua_newtable(L);
+	lua_pushnumber(L, (lua_Number)counters.styleApplied);
+	lua_setfield(L, -2, "style_applied");
+	lua_pushnumber(L, (lua_Number)counters.styleSkipped);
+	lua_setfield(L, -2, "style_skipped");
+	lua_pushnumber(L, (lua_Number)counters.exStyleApplied);
+	lua_setfield(L, -2, "ex_style_applied");
+	lua_pushnumber(L, (lua_Number)counters.exStyleSkipped);
+	lua_setfield(L, -2, "ex_style_skipped");
+	lua_pushnumber(L, (lua_Number)counters.posApplied);
+	lua_setfield(L, -2, "pos_applied");
+	lua_pushnumber(L, (lua_Number)counters.posSkipped);
+	lua_setfield(L, -2, "pos_skipped");
+	lua_pushnumber(L, (lua_Number)counters.frameChanges);
+	lua_setfield(L, -2, "frame_changes");
+	const ResizeCounters resizes = g_controller.GetResizeCounters();
+	lua_pushnumber(L, (lua_Number)resizes.held);
+	lua_setfield(L, -2, "resizes_held");
+	lua_pushnumber(L, (lua_Number)resizes.delivered);
+	lua_setfield(L, -2, "resizes_delivered");
+	lua_pushnumber(L, (lua_Number)resizes.lastTransitionDelivered);
+	lua_setfield(L, -2, "last_transition_resizes");
+	return 1;
+}
+
+static void PushDurationStats(lua_State* L, const DurationStats& stats)
+{
+	lua_newtable(L);
+	lua_pushnumber(L, (lua_Number)stats.count);
+	lua_setfield(L, -2, "count");
+	lua_pushnumber(L, stats.count ? stats.totalUs / 1000.0 / stats.count : 0.0);
+	lua_setfield(L, -2, "mean_ms");
+	lua_pushnumber(L, stats.minUs / 1000.0);
+	lua_setfield(L, -2, "min_ms");
+	lua_pushnumber(L, stats.maxUs / 1000.0);
+	lua_setfield(L, -2, "max_ms");
+	lua_pushnumber(L, stats.lastUs / 1000.0);
+	lua_setfield(L, -2, "last_ms");
+}
+
+int GetTransitionStats(lua_State* L)
+{
+	static const char* modeNames[TransitionStats::kModeCount] = { "fullscreen", "windowed", "fullscreen_windowed" };
+	lua_newtable(L);
+	for (int mode = 0; mode < TransitionStats::kModeCount; mode++)
+	{
+		ModeTransitionStats stats;
+		g_worker->GetStats().Get(mode, stats);
+		lua_newtable(L);
+		PushDurationStats(L, stats.total);
+		lua_setfield(L, -2, "total");
+		lua_newtable(L);
+		for (int stage = 0; stage < TRANSITION_STAGE_COUNT; stage++)
+		{
+			PushDurationStats(L, stats.stages[stage]);
+			lua_setfield(L, -2, GetTransitionStageName(stage));
+		}
+		lua_setfield(L, -2, "stages");
+		lua_setfield(L, -2, modeNames[mode]);
+	}
+	const TransitionWorker::Counters counters = g_worker->GetCounters();
+	lua_pushnumber(L, (lua_Number)counters.submitted);
+	lua_setfield(L, -2, "submitted");
+	lua_pushnumber(L, (lua_Number)counters.coalesced);
+	lua_setfield(L, -2, "coalesced");
+	lua_pushnumber(L, (lua_Number)counters.executed);
+	lua_setfield(L, -2, "executed");
+	lua_pushnumber(L, (lua_Number)counters.renderSettingsCalls);
+	lua_setfield(L, -2, "apply_render_settings_calls");
+	return 1;
+}
+
+int ResetTransitionStats(lua_State* L)
+{
+	g_worker->GetStats().Reset();
+	return 0;
+}
+
+static void PushFrameStats(lua_State* L, const FrameStats& stats)
+{
+	lua_newtable(L);
+	lua_pushnumber(L, (lua_Number)stats.frames);
+	lua_setfield(L, -2, "frames");
+	lua_pushnumber(L, stats.meanUs / 1000.0);
+	lua_setfield(L, -2, "mean_ms");
+	lua_pushnumber(L, stats.p50Us / 1000.0);
+	lua_setfield(L, -2, "p50_ms");
+	lua_pushnumber(L, stats.p95Us / 1000.0);
+	lua_setfield(L, -2, "p95_ms");
+	lua_pushnumber(L, stats.p99Us / 1000.0);
+	lua_setfield(L, -2, "p99_ms");
+	lua_pushnumber(L, stats.maxUs / 1000.0);
+	lua_setfield(L, -2, "max_ms");
+	lua_pushnumber(L, (lua_Number)stats.stutters);
+	lua_setfield(L, -2, "stutters");
+	lua_pushnumber(L, stats.stutterThresholdUs / 1000.0);
+	lua_setfield(L, -2, "stutter_threshold_ms");
+}
+
+// Frame pacing over the last few thousand frames. The optional argument is the stutter
+// threshold in milliseconds, twice the median frame time by default.
+int GetFrameStats(lua_State* L)
+{
+	const uint64_t thresholdUs = (uint64_t)(luaL_optnumber(L, 1, 0) * 1000.0);
+	PushFrameStats(L, g_frameTimer.GetStats(thresholdUs));
+	return 1;
+}
+
+int ResetFrameStats(lua_State* L)
+{
+	g_frameTimer.Reset();
+	return 0;
+}
+
+// Frames per second while the game is not in the foreground, 0 to never throttle.
+int SetBackgroundFpsCap(lua_State* L)
+{
+	const lua_Number fps = luaL_checknumber(L, 1);
+	g_frameThrottle.SetCap(fps > 0 ? (unsigned int)fps : 0);
+	return 0;
+}
+
+int GetBackgroundThrottle(lua_State* L)
+{
+	const FrameThrottleStats stats = g_frameThrottle.GetStats();
+	lua_newtable(L);
+	lua_pushinteger(L, g_frameThrottle.GetCap());
+	lua_setfield(L, -2, "cap");
+	lua_pushnumber(L, stats.throttledUs / 1000.0);
+	lua_setfield(L, -2, "throttled_ms");
+	lua_pushnumber(L, (lua_Number)stats.throttledFrames);
+	lua_setfield(L, -2, "throttled_frames");
+	lua_pushboolean(L, stats.active);
+	lua_setfield(L, -2, "active");
+	return 1;
+}
+
+int ResetBackgroundThrottleStats(lua_State* L)
+{
+	g_frameThrottle.ResetStats();
+	return 0;
+}
+
+// Turns the fullscreen windowed focus filter on or off. It is on by default.
+int SetFocusFilter(lua_State* L)
+{
+	g_focusFilter.SetEnabled(lua_toboolean(L, 1) != 0);
+	return 0;
+}
+
+// Alt-tab round trips, from the game being activated again to its next frame, with and without
+// the focus filter handling the switch.
+int GetAltTabStats(lua_State* L)
+{
+	const AltTabStats stats = g_focusFilter.GetStats();
+	lua_newtable(L);
+	PushDurationStats(L, stats.filtered);
+	lua_setfield(L, -2, "filtered");
+	PushDurationStats(L, stats.unfiltered);
+	lua_setfield(L, -2, "unfiltered");
+	lua_pushnumber(L, (lua_Number)stats.suppressed);
+	lua_setfield(L, -2, "suppressed");
+	lua_pushboolean(L, g_focusFilter.IsEnabled());
+	lua_setfield(L, -2, "enabled");
+	return 1;
+}
+
+// Starts writing a Chrome trace of transitions, window changes and frames. Takes the output
+// path, mods/logs/FullscreenWindowed_trace.json by default.
+int StartTrace(lua_State* L)
+{
+	const char* path = lua_isnoneornil(L, 1) ? "mods/logs/FullscreenWindowed_trace.json" : lua_tostring(L, 1);
+	lua_pushboolean(L, path && g_trace->Start(path));
+	return 1;
+}
+
+int StopTrace(lua_State* L)
+{
+	g_trace->Stop();
+	lua_pushnumber(L, (lua_Number)g_trace->GetDropped());
+	return 1;
+}
+
+// Starts measuring frame times in each display mode. Takes { modes, frames, settle_ms,
+// restore_mode, report_path } and a function switching the game to the mode it is given, which
+// is called from Plugin_Update and once more at the end to go back to restore_mode, by default
+// the mode last submitted. Returns false when a benchmark is already running.
+int StartFrameBenchmark(lua_State* L)
+{
+	if (!lua_istable(L, 1) || !lua_isfunction(L, 2))
+		return luaL_error(L, "start_frame_benchmark expects an options table and a function");
+	FrameBenchmarkOptions options = { {}, 600, 3000 };
+	lua_getfield(L, 1, "modes");
+	if (lua_istable(L, -1))
+	{
+		for (int i = 1;; i++)
+		{
+			lua_rawgeti(L, -1, i);
+			if (lua_isnoneornil(L, -1))
+			{
+				lua_pop(L, 1);
+				break;
+			}
+			options.modes.push_back(CheckDisplayMode(L, "start_frame_benchmark modes"));
+			lua_pop(L, 1);
+		}
+	}
+	else
+	{
+		options.modes = { DISPLAY_MODE_FULLSCREEN, DISPLAY_MODE_WINDOWED, DISPLAY_MODE_FULLSCREEN_WINDOWED };
+	}
+	lua_pop(L, 1);
+	int value;
+	if (GetIntField(L, 1, "frames", value))
+		options.frames = value;
+	if (GetIntField(L, 1, "settle_ms", value))
+		options.settleMs = value;
+	// The mode to return to is the one last asked for: the controller's lags behind a pending
+	// request.
+	int restoreMode = -1;
+	lua_getfield(L, 1, "restore_mode");
+	if (!lua_isnil(L, -1))
+		restoreMode = CheckDisplayMode(L, "start_frame_benchmark restore_mode");
+	lua_pop(L, 1);
+	if (restoreMode < 0)
+		restoreMode = g_worker->GetLatestMode();
+	if (restoreMode < 0)
+		restoreMode = g_controller.GetMode();
+	lua_getfield(L, 1, "report_path");
+	const char* path = lua_tostring(L, -1);
+	const std::string reportPath = path ? path : "mods/logs/FullscreenWindowed_benchmark.txt";
+	lua_pop(L, 1);
+
+	const bool started = g_frameBenchmark.Start(options, restoreMode);
+	if (started)
+	{
+		g_frameBenchmarkReportPath = reportPath;
+		SetCallback(g_benchmarkCallback, L, 2);
+	}
+	lua_pushboolean(L, started);
+	return 1;
+}
+
+int GetFrameBenchmark(lua_State* L)
+{
+	lua_newtable(L);
+	lua_pushboolean(L, g_frameBenchmark.IsRunning());
+	lua_setfield(L, -2, "running");
+	const std::vector<FrameBenchmarkResult>& results = g_frameBenchmark.GetResults();
+	lua_createtable(L, (int)results.size(), 0);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		PushFrameStats(L, results[i].stats);
+		lua_pushinteger(L, results[i].mode);
+		lua_setfield(L, -2, "mode");
+		lua_rawseti(L, -2, (int)i + 1);
+	}
+	lua_setfield(L, -2, "results");
+	if (g_frameBenchmark.IsFinished())
+	{
+		lua_pushinteger(L, g_frameBenchmark.GetBestMode());
+		lua_setfield(L, -2, "best_mode");
+		lua_pushstring(L, g_frameBenchmark.FormatReport().c_str());
+		lua_setfield(L, -2, "report");
+	}
+	return 1;
+}
+
+static void PushRect(lua_State* L, const WindowRect& rect)
+{
+	lua_newtable(L);
+	lua_pushinteger(L, rect.left);
+	lua_setfield(L, -2, "x");
+	lua_pushinteger(L, rect.top);
+	lua_setfield(L, -2, "y");
+	lua_pushinteger(L, rect.Width());
+	lua_setfield(L, -2, "width");
+	lua_pushinteger(L, rect.Height());
+	lua_setfield(L, -2, "height");
+}
+
+// Fullscreen windowed restricted to configurations DWM can promote to independent flip, see
+// DisplayModeController::SetFlipEnforced. Off by default.
+int SetFlipEnforced(lua_State* L)
+{
+	g_controller.SetFlipEnforced(lua_toboolean(L, 1) != 0);
+	return 0;
+}
+
+// Checks the window now and returns whether it qualifies for independent flip, with the names
+// of the conditions it does not meet.
+int GetFlipReport(lua_State* L)
+{
+	const FlipReport report = g_controller.CheckFlip();
+	lua_newtable(L);
+	lua_pushboolean(L, report.blockers == 0);
+	lua_setfield(L, -2, "eligible");
+	lua_newtable(L);
+	int count = 0;
+	for (int bit = 0; bit < FLIP_BLOCKER_COUNT; bit++)
+	{
+		if (!(report.blockers & (1u << bit)))
+			continue;
+		lua_pushstring(L, GetFlipBlockerName(bit));
+		lua_rawseti(L, -2, ++count);
+	}
+	lua_setfield(L, -2, "blockers");
+	PushRect(L, report.monitor);
+	lua_setfield(L, -2, "monitor");
+	lua_pushnumber(L, (lua_Number)report.checks);
+	lua_setfield(L, -2, "checks");
+	lua_pushnumber(L, (lua_Number)report.failures);
+	lua_setfield(L, -2, "failures");
+	lua_pushboolean(L, g_controller.IsFlipEnforced());
+	lua_setfield(L, -2, "enforced");
+	lua_pushboolean(L, report.scalingStretched);
+	lua_setfield(L, -2, "scaling_stretched");
+	return 1;
+}
+
+// The awareness the plugin's threads place the window with, the awareness the game window was
+// created with and the DPI it is scaled for, and the effective DPI of each monitor in enumeration order. Only the window's
+// awareness decides whether DWM stretches it.
+int GetDpiReport(lua_State* L)
 {
-	g_hMonitors.push_back(hMonitor);
-	return TRUE;
+	static const char* awarenessNames[] = { "unaware", "system", "per_monitor", "per_monitor_v2" };
+	lua_newtable(L);
+	lua_pushstring(L, awarenessNames[g_controller.GetDpiAwareness()]);
+	lua_setfield(L, -2, "awareness");
+	if (WindowHandle window = g_controller.GetWindow())
+	{
+		lua_pushstring(L, awarenessNames[g_backend.GetWindowDpiAwareness(window)]);
+		lua_setfield(L, -2, "window_awareness");
+		lua_pushinteger(L, g_backend.GetWindowDpi(window));
+		lua_setfield(L, -2, "window_dpi");
+	}
+	const std::shared_ptr<const MonitorTopologySnapshot> topology = g_controller.GetTopology().GetSnapshot();
+	lua_createtable(L, (int)topology->monitors.size(), 0);
+	for (size_t i = 0; i < topology->monitors.size(); i++)
+	{
+		const MonitorInfo& monitor = topology->monitors[i];
+		lua_newtable(L);
+		lua_pushstring(L, monitor.deviceName.c_str());
+		lua_setfield(L, -2, "device");
+		lua_pushinteger(L, monitor.dpi);
+		lua_setfield(L, -2, "dpi");
+		lua_pushnumber(L, (double)monitor.dpi / BW_DEFAULT_DPI);
+		lua_setfield(L, -2, "scale");
+		lua_rawseti(L, -2, (int)i + 1);
+	}
+	lua_setfield(L, -2, "monitors");
+	return 1;
+}
+
+// Returns the cached monitor topology in enumeration order, the generation, which changes
+// whenever the topology is rebuilt, and whether the adapter mapping was ambiguous. Each monitor
+// carries the adapter_index that presents to it, matching RenderSettings.adapter_index.
+int GetMonitors(lua_State* L)
+{
+	const std::shared_ptr<const MonitorTopologySnapshot> topology = g_controller.GetTopology().GetSnapshot();
+	lua_createtable(L, (int)topology->monitors.size(), 0);
+	for (size_t i = 0; i < topology->monitors.size(); i++)
+	{
+		const MonitorInfo& monitor = topology->monitors[i];
+		lua_newtable(L);
+		PushRect(L, monitor.rect);
+		lua_setfield(L, -2, "rect");
+		PushRect(L, monitor.workArea);
+		lua_setfield(L, -2, "work_area");
+		lua_pushinteger(L, monitor.refreshRate);
+		lua_setfield(L, -2, "refresh_rate");
+		lua_pushinteger(L, monitor.dpi);
+		lua_setfield(L, -2, "dpi");
+		lua_pushboolean(L, monitor.primary);
+		lua_setfield(L, -2, "primary");
+		lua_pushstring(L, monitor.deviceName.c_str());
+		lua_setfield(L, -2, "device_name");
+		for (int adapter = 0; adapter < (int)topology->monitors.size() || adapter < (int)topology->adapterMonitors.size(); adapter++)
+		{
+			if (topology->GetAdapterMonitor(adapter) == &monitor)
+			{
+				lua_pushinteger(L, adapter);
+				lua_setfield(L, -2, "adapter_index");
+				break;
+			}
+		}
+		lua_rawseti(L, -2, (int)i + 1);
+	}
+	lua_pushnumber(L, (lua_Number)topology->generation);
+	lua_pushboolean(L, topology->adapterMappingAmbiguous);
+	return 3;
+}
+
+// Resize coalescing goes first, so the focus filter only sees what it lets through.
+static bool InstallMessageHook()
+{
+	WindowHandle window = g_controller.GetWindow();
+	return window && g_backend.SetMessageHook(window, [](WindowMessage& message) {
+		return g_controller.FilterMessage(message) || g_focusFilter.OnMessage(message);
+	});
+}
+
+// The saved mode, when it is one the plugin has to apply at startup. Windowed needs nothing: the
+// engine creates its window with that style and the game's size.
+static bool GetSavedDisplayMode(TransitionRequest& request)
+{
+	double mode;
+	if (!g_settings->Get("display_mode", mode) || (int)mode != DISPLAY_MODE_FULLSCREEN_WINDOWED)
+		return false;
+	double adapter = 0;
+	double scaling = 0;
+	double width = 0;
+	double height = 0;
+	g_settings->Get("adapter_index", adapter);
+	g_settings->Get("present_scaling", scaling);
+	g_settings->Get("render_width", width);
+	g_settings->Get("render_height", height);
+	request = {};
+	request.mode = DISPLAY_MODE_FULLSCREEN_WINDOWED;
+	request.adapter = (int)adapter;
+	request.scaling = (int)scaling;
+	request.width = (int)width;
+	request.height = (int)height;
+	return true;
+}
+
+// Hooks a window attached after Plugin_Init and submits the saved mode for it. Runs on the game
+// thread only, so the hook is never installed from two threads at once.
+static void SetupAttachedWindow()
+{
+	const WindowHandle window = g_controller.GetWindow();
+	if (!window || window == g_setupWindow)
+		return;
+	g_setupWindow = window;
+	PD2HOOK_LOG_LOG("Found PAYDAY 2 window.");
+	if (!InstallMessageHook())
+		PD2HOOK_LOG_WARN("Failed to hook the PAYDAY 2 window procedure.");
+	TransitionRequest request;
+	if (GetSavedDisplayMode(request))
+		g_worker->Submit(request);
 }
 
 void Plugin_Init()
 {
 	PD2HOOK_LOG_LOG("Initializing Borderless Windowed Updated");
-	g_hWnd = FindWindow(L"diesel win32", L"PAYDAY 2");
-	if (!g_hWnd)
+	g_settings->Load();
+	g_settings->Start();
+	g_controller.SetTrace(g_trace);
+	double backgroundFpsCap;
+	if (g_settings->Get("background_fps_cap", backgroundFpsCap) && backgroundFpsCap > 0)
+		g_frameThrottle.SetCap((unsigned int)backgroundFpsCap);
+	g_frameThrottle.SetBusyCheck([] { return g_worker->GetActiveRequest() != 0; });
+	// The engine may not have created its window yet; in that case Plugin_Update sets it up as
+	// soon as the window shows up.
+	g_controller.WatchWindow();
+	g_setupWindow = g_controller.GetWindow();
+	// Only this thread's awareness changes, never the process's: it adopts the window's, or
+	// becomes per-monitor aware so the window the engine creates on it later is too.
+	g_controller.RefreshMonitors();
+	if (!g_setupWindow)
 	{
-		PD2HOOK_LOG_ERROR("Failed to find PAYDAY 2 window.");
-		return;
+		PD2HOOK_LOG_LOG("PAYDAY 2 window not created yet, waiting for it.");
+	}
+	else
+	{
+		if (!InstallMessageHook())
+			PD2HOOK_LOG_WARN("Failed to hook the PAYDAY 2 window procedure.");
+		if (g_backend.GetWindowDpiAwareness(g_setupWindow) < BW_DPI_PER_MONITOR_AWARE)
+			PD2HOOK_LOG_WARN("The PAYDAY 2 window is not per-monitor DPI aware, scaled monitors will be stretched by DWM.");
 	}
-	EnumDisplayMonitors(NULL, NULL, MonitorEnumProcCallback, NULL);
+	g_worker->Start();
+	// On the worker, so waiting for the engine to settle never holds up the game's startup.
+	TransitionRequest request;
+	if (g_setupWindow && GetSavedDisplayMode(request))
+		g_worker->Submit(request);
 	PD2HOOK_LOG_LOG("Borderless Windowed Updated loaded successfully.");
 }
 
+static void PushTransitionResult(lua_State* L, const TransitionResult& result)
+{
+	lua_newtable(L);
+	lua_pushnumber(L, (lua_Number)result.id);
+	lua_setfield(L, -2, "id");
+	lua_pushinteger(L, result.mode);
+	lua_setfield(L, -2, "mode");
+	lua_pushboolean(L, result.restore);
+	lua_setfield(L, -2, "rollback");
+	lua_pushboolean(L, result.success);
+	lua_setfield(L, -2, "success");
+	PushRect(L, result.rect);
+	lua_setfield(L, -2, "rect");
+	lua_pushnumber(L, result.elapsedUs / 1000.0);
+	lua_setfield(L, -2, "elapsed_ms");
+	lua_pushnumber(L, (lua_Number)result.coalesced);
+	lua_setfield(L, -2, "coalesced");
+	lua_pushnumber(L, (lua_Number)result.renderSettingsCalls);
+	lua_setfield(L, -2, "apply_render_settings_calls");
+	if (!result.success)
+	{
+		lua_pushstring(L, result.error.c_str());
+		lua_setfield(L, -2, "error");
+		lua_pushboolean(L, result.deferred);
+		lua_setfield(L, -2, "deferred");
+	}
+}
+
+static void UpdateFrameBenchmark(uint64_t now)
+{
+	if (!g_frameBenchmark.IsRunning())
+		return;
+	const int mode = g_frameBenchmark.Tick(now);
+	if (mode >= 0)
+	{
+		if (lua_State* L = PushCallback(g_benchmarkCallback))
+		{
+			lua_pushinteger(L, mode);
+			CallCallback(L, 1);
+		}
+		else
+		{
+			g_frameBenchmark.Cancel();
+		}
+	}
+	if (g_frameBenchmark.IsFinished())
+	{
+		const std::string report = g_frameBenchmark.FormatReport();
+		PD2HOOK_LOG_LOG(("Frame benchmark finished\n" + report).c_str());
+		std::ofstream file(g_frameBenchmarkReportPath, std::ios::trunc);
+		if (file)
+			file << report;
+		else
+			PD2HOOK_LOG_ERROR(("Failed to write " + g_frameBenchmarkReportPath).c_str());
+	}
+	if (!g_frameBenchmark.IsRunning())
+		ReleaseCallback(g_benchmarkCallback);
+}
+
+// Results are only ever handed to Lua here, on the game thread.
 void Plugin_Update()
 {
+	const uint64_t now = g_backend.GetTime();
+	g_frameTimer.Tick(now);
+	g_focusFilter.OnFrame(now);
+	if (g_lastFrame)
+		g_trace->Complete(TRACE_THREAD_GAME, "frame", "frame", g_lastFrame, now - g_lastFrame);
+	g_lastFrame = now;
+	UpdateFrameBenchmark(now);
+	SetupAttachedWindow();
+	// A transition deferred by a minimized window runs again once the window is restored.
+	WindowState state;
+	if (g_worker->HasDeferred() && g_backend.GetWindowState(g_controller.GetWindow(), state) && !state.minimized)
+		g_worker->ResumeDeferred();
+
+	std::vector<TransitionResult> results;
+	g_worker->TakeResults(results);
+	for (const TransitionResult& result : results)
+	{
+		lua_State* L = PushCallback(g_transitionCallback);
+		if (!L)
+			break;
+		PushTransitionResult(L, result);
+		CallCallback(L, 1);
+	}
+
+	// Last, so the wait does not delay anything handed to Lua this frame. Exclusive fullscreen is
+	// left to the engine, only the modes that keep presenting in the background are throttled.
+	const int mode = g_controller.GetMode();
+	const bool windowed = mode == DISPLAY_MODE_WINDOWED || mode == DISPLAY_MODE_FULLSCREEN_WINDOWED;
+	g_frameThrottle.OnFrame(windowed ? g_controller.GetWindow() : nullptr);
 }
 
 void Plugin_Setup_Lua(lua_State* L)
@@ -108,5 +876,98 @@ int Plugin_PushLua(lua_State* L)
 	lua_pushcfunction(L, ChangeDisplayMode);
 	lua_setfield(L, -2, "change_display_mode");
 
+	lua_pushcfunction(L, ApplyDisplayConfig);
+	lua_setfield(L, -2, "apply_display_config");
+
+	lua_pushcfunction(L, NoteRenderSettingsApplied);
+	lua_setfield(L, -2, "note_render_settings_applied");
+
+	lua_pushcfunction(L, GetActiveTransition);
+	lua_setfield(L, -2, "get_active_transition");
+
+	lua_pushcfunction(L, BeginTransition);
+	lua_setfield(L, -2, "begin_transition");
+
+	lua_pushcfunction(L, CommitTransition);
+	lua_setfield(L, -2, "commit");
+
+	lua_pushcfunction(L, RollbackTransition);
+	lua_setfield(L, -2, "rollback");
+
+	lua_pushcfunction(L, SetTransitionCallback);
+	lua_setfield(L, -2, "set_transition_callback");
+
+	lua_pushcfunction(L, GetReconcileStats);
+	lua_setfield(L, -2, "get_reconcile_stats");
+
+	lua_pushcfunction(L, GetMonitors);
+	lua_setfield(L, -2, "get_monitors");
+
+	lua_pushcfunction(L, GetTransitionStats);
+	lua_setfield(L, -2, "get_transition_stats");
+
+	lua_pushcfunction(L, ResetTransitionStats);
+	lua_setfield(L, -2, "reset_transition_stats");
+
+	lua_pushcfunction(L, GetFrameStats);
+	lua_setfield(L, -2, "get_frame_stats");
+
+	lua_pushcfunction(L, ResetFrameStats);
+	lua_setfield(L, -2, "reset_frame_stats");
+
+	lua_pushcfunction(L, SetBackgroundFpsCap);
+	lua_setfield(L, -2, "set_background_fps_cap");
+
+	lua_pushcfunction(L, GetBackgroundThrottle);
+	lua_setfield(L, -2, "get_background_throttle");
+
+	lua_pushcfunction(L, ResetBackgroundThrottleStats);
+	lua_setfield(L, -2, "reset_background_throttle_stats");
+
+	lua_pushcfunction(L, SetFocusFilter);
+	lua_setfield(L, -2, "set_focus_filter");
+
+	lua_pushcfunction(L, GetAltTabStats);
+	lua_setfield(L, -2, "get_alt_tab_stats");
+
+	lua_pushcfunction(L, StartTrace);
+	lua_setfield(L, -2, "start_trace");
+
+	lua_pushcfunction(L, StopTrace);
+	lua_setfield(L, -2, "stop_trace");
+
+	lua_pushcfunction(L, StartFrameBenchmark);
+	lua_setfield(L, -2, "start_frame_benchmark");
+
+	lua_pushcfunction(L, GetFrameBenchmark);
+	lua_setfield(L, -2, "get_frame_benchmark");
+
+	lua_pushcfunction(L, GetLocalizedStringsLua);
+	lua_setfield(L, -2, "get_localized_strings");
+
+	lua_pushcfunction(L, GetSettings);
+	lua_setfield(L, -2, "get_settings");
+
+	lua_pushcfunction(L, StopSettings);
+	lua_setfield(L, -2, "stop_settings");
+
+	lua_pushcfunction(L, SetSetting);
+	lua_setfield(L, -2, "set_setting");
+
+	lua_pushcfunction(L, SetFlipEnforced);
+	lua_setfield(L, -2, "set_flip_enforced");
+
+	lua_pushcfunction(L, GetFlipReport);
+	lua_setfield(L, -2, "get_flip_report");
+
+	lua_pushcfunction(L, GetDpiReport);
+	lua_setfield(L, -2, "get_dpi_report");
+
+	lua_pushcfunction(L, SetReadinessOptions);
+	lua_setfield(L, -2, "set_readiness_options");
+
+	lua_pushcfunction(L, GetReadinessReport);
+	lua_setfield(L, -2, "get_readiness_report");
+
 	return 1;
 }
@@ -0,0 +1,80 @@
+#include "monitor_topology.h"
+#include "logging.h"
+
+const MonitorInfo* MonitorTopologySnapshot::GetAdapterMonitor(int adapter) const
+{
+	if (adapter < 0)
+		return nullptr;
+	if (adapterMonitors.empty())
+	{
+		// No adapter information, assume enumeration order like the plugin always did.
+		return adapter < (int)monitors.size() ? &monitors[adapter] : nullptr;
+	}
+	if (adapter >= (int)adapterMonitors.size() || adapterMonitors[adapter] < 0)
+		return nullptr;
+	return &monitors[adapterMonitors[adapter]];
+}
+
+// EnumDisplayMonitors order is not the adapter ordinal order, so match the two by device name.
+static void MapAdapters(MonitorTopologySnapshot& snapshot, const std::vector<std::string>& adapters)
+{
+	snapshot.adapterMonitors.assign(adapters.size(), -1);
+	std::vector<int> claimed(snapshot.monitors.size(), 0);
+	for (size_t adapter = 0; adapter < adapters.size(); adapter++)
+	{
+		int matches = 0;
+		for (size_t monitor = 0; monitor < snapshot.monitors.size(); monitor++)
+		{
+			if (snapshot.monitors[monitor].deviceName != adapters[adapter])
+				continue;
+			if (matches++ == 0)
+				snapshot.adapterMonitors[adapter] = (int)monitor;
+			claimed[monitor]++;
+		}
+		if (matches != 1)
+		{
+			snapshot.adapterMappingAmbiguous = true;
+			const std::string message = "Adapter " + std::to_string(adapter) + " (" + adapters[adapter] + ") matches " + std::to_string(matches) + " monitors";
+			PD2HOOK_LOG_WARN(message.c_str());
+		}
+	}
+	for (size_t monitor = 0; monitor < claimed.size(); monitor++)
+	{
+		if (claimed[monitor] > 1)
+		{
+			snapshot.adapterMappingAmbiguous = true;
+			const std::string message = "Monitor " + snapshot.monitors[monitor].deviceName + " is claimed by " + std::to_string(claimed[monitor]) + " adapters";
+			PD2HOOK_LOG_WARN(message.c_str());
+		}
+	}
+}
+
+MonitorTopology::MonitorTopology(WindowBackend& backend)
+	: m_backend(backend), m_snapshot(std::make_shared<MonitorTopologySnapshot>())
+{
+}
+
+void MonitorTopology::Rebuild()
+{
+	std::lock_guard<std::mutex> lock(m_rebuildMutex);
+	const std::shared_ptr<const MonitorTopologySnapshot> previous = GetSnapshot();
+	auto snapshot = std::make_shared<MonitorTopologySnapshot>();
+	snapshot->generation = previous->generation + 1;
+	snapshot->monitors = m_backend.QueryMonitors();
+	snapshot->desktop = m_backend.GetDesktopRect();
+	const std::vector<std::string> adapters = m_backend.QueryAdapterDevices();
+	if (!adapters.empty())
+		MapAdapters(*snapshot, adapters);
+	std::atomic_store(&m_snapshot, std::shared_ptr<const MonitorTopologySnapshot>(std::move(snapshot)));
+}
+
+void MonitorTopology::Watch()
+{
+	m_backend.SetDisplayChangeCallback([this] { Rebuild(); });
+	Rebuild();
+}
+
+std::shared_ptr<const MonitorTopologySnapshot> MonitorTopology::GetSnapshot() const
+{
+	return std::atomic_load(&m_snapshot);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "window_backend.h"
+#include <memory>
+#include <mutex>
+
+struct MonitorTopologySnapshot
+{
+	// Incremented on every rebuild, so readers can tell whether anything changed.
+	uint64_t generation = 0;
+	std::vector<MonitorInfo> monitors;
+	WindowRect desktop = {};
+	// Index into monitors for each Direct3D adapter ordinal, -1 when the adapter drives no
+	// monitor. Empty when the adapters could not be enumerated.
+	std::vector<int> adapterMonitors;
+	// Set when the device names did not give a one-to-one mapping.
+	bool adapterMappingAmbiguous = false;
+
+	// The monitor the given adapter ordinal presents to, or null when unknown.
+	const MonitorInfo* GetAdapterMonitor(int adapter) const;
+};
+
+// Cached monitor layout. It is rebuilt only when the backend reports a display change and is
+// published as an immutable snapshot: readers grab the current pointer and never block the
+// rebuild, and a rebuild never mutates a snapshot someone is still looking at. Rebuilds are
+// serialised among themselves, since the display-change callback can race the first one.
+class MonitorTopology
+{
+public:
+	explicit MonitorTopology(WindowBackend& backend);
+
+	void Rebuild();
+	// Rebuilds now and again on every display change reported by the backend.
+	void Watch();
+
+	std::shared_ptr<const MonitorTopologySnapshot> GetSnapshot() const;
+
+private:
+	WindowBackend& m_backend;
+	// Writers only, GetSnapshot never takes it.
+	std::mutex m_rebuildMutex;
+	std::shared_ptr<const MonitorTopologySnapshot> m_snapshot;
+};
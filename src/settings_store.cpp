@@ -0,0 +1,289 @@
+#include "settings_store.h"
+#include "logging.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Changes arriving this close together, like a mode switch followed by its decline, end up in
+// a single write.
+static const std::chrono::milliseconds kCoalesceDelay(100);
+
+SettingsStore::SettingsStore(const std::string& path)
+	: m_path(path), m_dirty(false), m_writing(false), m_flushRequested(false), m_stop(false), m_writes(0)
+{
+}
+
+SettingsStore::~SettingsStore()
+{
+	Stop();
+}
+
+bool SettingsStore::Load()
+{
+	std::ifstream file(m_path, std::ios::binary);
+	if (!file)
+		return false;
+	std::stringstream contents;
+	contents << file.rdbuf();
+	std::map<std::string, double> values;
+	if (!Parse(contents.str(), values))
+	{
+		PD2HOOK_LOG_WARN(("Ignoring malformed settings file " + m_path).c_str());
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const auto& value : values)
+		m_values[value.first] = value.second;
+	return true;
+}
+
+void SettingsStore::Start()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_thread.joinable())
+		return;
+	m_stop = false;
+	m_thread = std::thread(&SettingsStore::Run, this);
+}
+
+void SettingsStore::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	if (m_thread.joinable())
+		m_thread.join();
+	// Changes the thread did not get to, or made while it was not running.
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_dirty && Write(m_values))
+	{
+		m_dirty = false;
+		m_writes++;
+	}
+}
+
+bool SettingsStore::Reopen(const std::string& path)
+{
+	bool running;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		running = m_thread.joinable();
+	}
+	Stop();
+	// Nothing else reads the path while the thread is stopped.
+	m_path = path;
+	const bool loaded = Load();
+	if (running)
+		Start();
+	return loaded;
+}
+
+bool SettingsStore::Get(const std::string& key, double& value) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_values.find(key);
+	if (it == m_values.end())
+		return false;
+	value = it->second;
+	return true;
+}
+
+std::map<std::string, double> SettingsStore::GetAll() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_values;
+}
+
+void SettingsStore::Set(const std::string& key, double value)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_values.find(key);
+		if (it != m_values.end() && it->second == value)
+			return;
+		m_values[key] = value;
+		m_dirty = true;
+	}
+	m_wake.notify_one();
+}
+
+void SettingsStore::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_thread.joinable())
+		return;
+	m_flushRequested = true;
+	m_wake.notify_one();
+	m_idle.wait(lock, [this] { return (!m_dirty && !m_writing) || m_stop; });
+	m_flushRequested = false;
+}
+
+uint64_t SettingsStore::GetWrites() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_writes;
+}
+
+void SettingsStore::Run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_wake.wait(lock, [this] { return m_dirty || m_stop; });
+		if (!m_dirty)
+			break;
+		m_wake.wait_for(lock, kCoalesceDelay, [this] { return m_stop || m_flushRequested; });
+		const std::map<std::string, double> values = m_values;
+		m_dirty = false;
+		m_writing = true;
+		lock.unlock();
+
+		const bool written = Write(values);
+
+		lock.lock();
+		m_writing = false;
+		if (written)
+			m_writes++;
+		m_idle.notify_all();
+	}
+	m_idle.notify_all();
+}
+
+static bool ReplaceFile(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool SettingsStore::Write(const std::map<std::string, double>& values)
+{
+	const std::string temp = m_path + ".tmp";
+	std::FILE* file = std::fopen(temp.c_str(), "wb");
+	if (!file)
+	{
+		PD2HOOK_LOG_ERROR(("Failed to write " + temp).c_str());
+		return false;
+	}
+	const std::string json = Format(values);
+	bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size() && std::fflush(file) == 0;
+#ifdef _WIN32
+	ok = ok && _commit(_fileno(file)) == 0;
+#else
+	ok = ok && fsync(fileno(file)) == 0;
+#endif
+	ok = std::fclose(file) == 0 && ok;
+	if (!ok || !ReplaceFile(temp, m_path))
+	{
+		PD2HOOK_LOG_ERROR(("Failed to save " + m_path).c_str());
+		std::remove(temp.c_str());
+		return false;
+	}
+	return true;
+}
+
+static void SkipSpace(const char*& at)
+{
+	while (*at == ' ' || *at == '\t' || *at == '\r' || *at == '\n')
+		at++;
+}
+
+static bool ParseKey(const char*& at, std::string& key)
+{
+	if (*at != '"')
+		return false;
+	key.clear();
+	for (at++; *at != '"'; at++)
+	{
+		if (!*at)
+			return false;
+		if (*at == '\\' && at[1])
+			at++;
+		key += *at;
+	}
+	at++;
+	return true;
+}
+
+bool SettingsStore::Parse(const std::string& json, std::map<std::string, double>& values)
+{
+	const char* at = json.c_str();
+	SkipSpace(at);
+	if (*at++ != '{')
+		return false;
+	SkipSpace(at);
+	if (*at == '}')
+		return true;
+	for (;;)
+	{
+		std::string key;
+		SkipSpace(at);
+		if (!ParseKey(at, key))
+			return false;
+		SkipSpace(at);
+		if (*at++ != ':')
+			return false;
+		SkipSpace(at);
+		double value;
+		if (json.compare(at - json.c_str(), 4, "true") == 0)
+		{
+			value = 1;
+			at += 4;
+		}
+		else if (json.compare(at - json.c_str(), 5, "false") == 0)
+		{
+			value = 0;
+			at += 5;
+		}
+		else
+		{
+			char* end;
+			value = std::strtod(at, &end);
+			if (end == at)
+				return false;
+			at = end;
+		}
+		values[key] = value;
+		SkipSpace(at);
+		if (*at == '}')
+			return true;
+		if (*at++ != ',')
+			return false;
+	}
+}
+
+std::string SettingsStore::Format(const std::map<std::string, double>& values)
+{
+	std::string json = "{";
+	char number[32];
+	for (const auto& value : values)
+	{
+		if (json.size() > 1)
+			json += ",";
+		json += "\"";
+		for (char c : value.first)
+		{
+			if (c == '"' || c == '\\')
+				json += '\\';
+			json += c;
+		}
+		json += "\":";
+		std::snprintf(number, sizeof(number), "%.17g", value.second);
+		json += number;
+	}
+	json += "}";
+	return json;
+}
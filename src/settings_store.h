@@ -0,0 +1,54 @@
+#pragma once
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// The mod's settings, kept in memory and persisted as a flat JSON object of numbers. Set never
+// touches the disk: a background thread collects bursts of changes into one write, which goes
+// to a temporary file that then replaces the real one, so a crash mid-write leaves either the
+// old or the new file and never a truncated one.
+class SettingsStore
+{
+public:
+	explicit SettingsStore(const std::string& path);
+	~SettingsStore();
+
+	// Reads the file synchronously. Returns false when it is missing or unreadable, in which
+	// case the values are left alone.
+	bool Load();
+	void Start();
+	// Joins the thread, then writes anything still pending on the calling thread.
+	void Stop();
+	// Moves to another file: pending changes still go to the old one, then the new one is loaded
+	// like Load and the thread restarts if it was running. Call from one thread only.
+	bool Reopen(const std::string& path);
+	const std::string& GetPath() const { return m_path; }
+
+	bool Get(const std::string& key, double& value) const;
+	std::map<std::string, double> GetAll() const;
+	void Set(const std::string& key, double value);
+	// Blocks until every change so far is on disk. Does nothing while the store is stopped.
+	void Flush();
+	uint64_t GetWrites() const;
+
+	static bool Parse(const std::string& json, std::map<std::string, double>& values);
+	static std::string Format(const std::map<std::string, double>& values);
+
+private:
+	void Run();
+	bool Write(const std::map<std::string, double>& values);
+
+	std::string m_path;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_idle;
+	std::map<std::string, double> m_values;
+	bool m_dirty;
+	bool m_writing;
+	bool m_flushRequested;
+	bool m_stop;
+	uint64_t m_writes;
+	std::thread m_thread;
+};
@@ -0,0 +1,505 @@
+#include "simulated_backend.h"
+#include <algorithm>
+
+// Frame metrics of the simulated window manager, loosely modelled on Windows 10 at 100% scale.
+static const int kCaptionHeight = 23;
+static const int kBorderWidth = 3;
+static const int kEdgeWidth = 2;
+
+// The metrics above scaled to `dpi`.
+static WindowRect AdjustRect(const WindowRect& client, uint32_t style, uint32_t exStyle, unsigned int dpi)
+{
+	const int border = kBorderWidth * (int)dpi / BW_DEFAULT_DPI;
+	const int caption = kCaptionHeight * (int)dpi / BW_DEFAULT_DPI;
+	const int edge = kEdgeWidth * (int)dpi / BW_DEFAULT_DPI;
+	WindowRect rect = client;
+	if (style & BW_WS_CAPTION)
+	{
+		rect.left -= border;
+		rect.right += border;
+		rect.top -= border + caption;
+		rect.bottom += border;
+	}
+	if (exStyle & BW_WS_EX_CLIENTEDGE)
+	{
+		rect.left -= edge;
+		rect.top -= edge;
+		rect.right += edge;
+		rect.bottom += edge;
+	}
+	return rect;
+}
+
+static const char* GetMessageName(WindowMessageType type)
+{
+	switch (type)
+	{
+	case WINDOW_MESSAGE_ACTIVATE_APP:
+		return "WM_ACTIVATEAPP";
+	case WINDOW_MESSAGE_SIZE:
+		return "WM_SIZE";
+	case WINDOW_MESSAGE_WINDOW_POS_CHANGED:
+		return "WM_WINDOWPOSCHANGED";
+	case WINDOW_MESSAGE_MINIMIZE_COMMAND:
+		return "WM_SYSCOMMAND";
+	case WINDOW_MESSAGE_MOVE:
+		return "WM_MOVE";
+	}
+	return "";
+}
+
+SimulatedBackend::SimulatedBackend()
+	: m_gameWindow(nullptr), m_hookedWindow(nullptr), m_foreground(nullptr), m_backdropShown(false), m_backdropRect(), m_queries(0), m_calls(), m_time(0), m_posCost(0), m_nextHandle(1)
+{
+}
+
+WindowHandle SimulatedBackend::CreateGameWindow(const WindowRect& rect, uint32_t style, uint32_t exStyle)
+{
+	WindowHandle window;
+	std::function<void(WindowHandle)> callback;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		window = reinterpret_cast<WindowHandle>(m_nextHandle++);
+		auto awareness = m_threadAwareness.find(std::this_thread::get_id());
+		m_windows[window] = Window{ style, exStyle, rect, false, false, false, awareness != m_threadAwareness.end() ? awareness->second : BW_DPI_UNAWARE };
+		m_gameWindow = window;
+		m_foreground = window;
+		callback = m_gameWindowCreated;
+	}
+	if (callback)
+		callback(window);
+	return window;
+}
+
+void SimulatedBackend::ReportGameWindow(WindowHandle window)
+{
+	std::function<void(WindowHandle)> callback;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		callback = m_gameWindowCreated;
+	}
+	if (callback)
+		callback(window);
+}
+
+void SimulatedBackend::SetForeground(WindowHandle window)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_foreground = window;
+}
+
+bool SimulatedBackend::IsForegroundWindow(WindowHandle window)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return window && window == m_foreground;
+}
+
+void SimulatedBackend::DestroyWindow(WindowHandle window)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_windows.erase(window);
+	if (m_gameWindow == window)
+		m_gameWindow = nullptr;
+}
+
+MonitorHandle SimulatedBackend::AddMonitor(const WindowRect& rect)
+{
+	MonitorInfo info{ nullptr, rect, rect, 60, 96, false, std::string() };
+	info.workArea.bottom -= 40;
+	return AddMonitorInfo(info);
+}
+
+MonitorHandle SimulatedBackend::AddMonitorInfo(const MonitorInfo& info)
+{
+	MonitorHandle monitor;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		monitor = reinterpret_cast<MonitorHandle>(m_nextHandle++);
+		m_monitors.push_back(info);
+		m_monitors.back().handle = monitor;
+		if (m_monitors.size() == 1)
+			m_monitors.back().primary = true;
+		if (info.deviceName.empty())
+			m_monitors.back().deviceName = "\\\\.\\DISPLAY" + std::to_string(m_monitors.size());
+	}
+	NotifyDisplayChange();
+	return monitor;
+}
+
+void SimulatedBackend::RemoveMonitor(MonitorHandle monitor)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_monitors.erase(std::remove_if(m_monitors.begin(), m_monitors.end(), [monitor](const MonitorInfo& info) { return info.handle == monitor; }), m_monitors.end());
+	}
+	NotifyDisplayChange();
+}
+
+void SimulatedBackend::UpdateMonitor(const MonitorInfo& info)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (MonitorInfo& monitor : m_monitors)
+		{
+			if (monitor.handle == info.handle)
+				monitor = info;
+		}
+	}
+	NotifyDisplayChange();
+}
+
+int SimulatedBackend::GetQueryCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queries;
+}
+
+void SimulatedBackend::SetAdapterDevices(const std::vector<std::string>& devices)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_adapters = devices;
+	}
+	NotifyDisplayChange();
+}
+
+SimulatedBackend::Window SimulatedBackend::GetWindow(WindowHandle window)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_windows.at(window);
+}
+
+std::vector<SimulatedBackend::Message> SimulatedBackend::GetMessages()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_messages;
+}
+
+SimulatedBackend::Calls SimulatedBackend::GetCalls()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_calls;
+}
+
+void SimulatedBackend::ResetCounters()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_calls = Calls();
+	m_messages.clear();
+}
+
+void SimulatedBackend::ScheduleWindowState(WindowHandle window, uint64_t time, const Window& state)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_scheduled.push_back(ScheduledState{ time, window, state });
+}
+
+void SimulatedBackend::AdvanceTime(uint64_t microseconds)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	AdvanceTimeLocked(microseconds);
+}
+
+void SimulatedBackend::SetPosCost(uint64_t microseconds)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_posCost = microseconds;
+}
+
+WindowHandle SimulatedBackend::FindGameWindow()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_gameWindow;
+}
+
+void SimulatedBackend::SetGameWindowCallback(std::function<void(WindowHandle)> callback)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_gameWindowCreated = std::move(callback);
+}
+
+bool SimulatedBackend::IsWindowValid(WindowHandle window)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_windows.count(window) != 0;
+}
+
+bool SimulatedBackend::SetMessageHook(WindowHandle window, std::function<bool(WindowMessage&)> hook)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_windows.count(window))
+		return false;
+	m_hookedWindow = window;
+	m_messageHook = std::move(hook);
+	return true;
+}
+
+bool SimulatedBackend::DeliverMessage(WindowHandle window, const WindowMessage& message)
+{
+	std::function<bool(WindowMessage&)> hook;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (window == m_hookedWindow)
+			hook = m_messageHook;
+	}
+	WindowMessage delivered = message;
+	if (hook && hook(delivered))
+		return false;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const bool hasRect = delivered.type == WINDOW_MESSAGE_SIZE || delivered.type == WINDOW_MESSAGE_MOVE;
+	PostMessage(window, GetMessageName(delivered.type), hasRect ? delivered.rect : WindowRect());
+	return true;
+}
+
+void SimulatedBackend::SetBackdrop(WindowHandle, const WindowRect* rect)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_backdropShown = rect != nullptr;
+	if (rect)
+		m_backdropRect = *rect;
+}
+
+bool SimulatedBackend::GetBackdrop(WindowRect& rect)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	rect = m_backdropRect;
+	return m_backdropShown;
+}
+
+std::vector<MonitorInfo> SimulatedBackend::QueryMonitors()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_queries++;
+	return m_monitors;
+}
+
+std::vector<std::string> SimulatedBackend::QueryAdapterDevices()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_adapters.empty())
+		return m_adapters;
+	std::vector<std::string> devices;
+	for (const MonitorInfo& monitor : m_monitors)
+		devices.push_back(monitor.deviceName);
+	return devices;
+}
+
+WindowRect SimulatedBackend::GetDesktopRect()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_monitors.empty())
+		return WindowRect{ 0, 0, 0, 0 };
+	WindowRect rect = m_monitors[0].rect;
+	for (const MonitorInfo& monitor : m_monitors)
+	{
+		rect.left = std::min(rect.left, monitor.rect.left);
+		rect.top = std::min(rect.top, monitor.rect.top);
+		rect.right = std::max(rect.right, monitor.rect.right);
+		rect.bottom = std::max(rect.bottom, monitor.rect.bottom);
+	}
+	return rect;
+}
+
+void SimulatedBackend::SetDisplayChangeCallback(std::function<void()> callback)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_displayChange = std::move(callback);
+}
+
+void SimulatedBackend::SetWindowStyle(WindowHandle window, uint32_t style)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_calls.setStyle++;
+	m_windows.at(window).style = style;
+	PostMessage(window, "WM_STYLECHANGED");
+}
+
+void SimulatedBackend::SetWindowExStyle(WindowHandle window, uint32_t exStyle)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_calls.setExStyle++;
+	m_windows.at(window).exStyle = exStyle;
+	PostMessage(window, "WM_STYLECHANGED");
+}
+
+WindowRect SimulatedBackend::AdjustWindowRect(const WindowRect& client, uint32_t style, uint32_t exStyle, unsigned int dpi)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_calls.adjustRect++;
+	return AdjustRect(client, style, exStyle, dpi);
+}
+
+void SimulatedBackend::SetWindowPos(WindowHandle window, WindowZOrder order, int x, int y, int width, int height, bool frameChanged)
+{
+	bool sized;
+	bool moved;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_calls.setPos++;
+		Window& target = m_windows.at(window);
+		const WindowRect rect{ x, y, x + width, y + height };
+		sized = rect.Width() != target.rect.Width() || rect.Height() != target.rect.Height();
+		moved = rect.left != target.rect.left || rect.top != target.rect.top;
+		if (order == WindowZOrder::NoTopmost)
+			target.topmost = false;
+		target.rect = rect;
+		if (frameChanged)
+		{
+			m_calls.frameChanged++;
+			PostMessage(window, "WM_NCCALCSIZE");
+		}
+	}
+	// Sent like the system sends them, so the message hook sees them before they are logged.
+	// Default handling of WM_WINDOWPOSCHANGED sends WM_MOVE and WM_SIZE, so swallowing it drops
+	// both.
+	if (frameChanged || sized || moved)
+	{
+		WindowMessage message = {};
+		message.type = WINDOW_MESSAGE_WINDOW_POS_CHANGED;
+		message.rect = { x, y, x + width, y + height };
+		if (DeliverMessage(window, message))
+		{
+			if (moved)
+				PostMove(window);
+			if (frameChanged || sized)
+				PostResize(window);
+		}
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	AdvanceTimeLocked(m_posCost);
+}
+
+bool SimulatedBackend::GetWindowState(WindowHandle window, WindowState& state)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_calls.getState++;
+	auto it = m_windows.find(window);
+	if (it == m_windows.end())
+		return false;
+	const Window& target = it->second;
+	state = WindowState{ target.style, target.exStyle, target.rect, target.minimized, target.exclusiveFullscreen };
+	return true;
+}
+
+void SimulatedBackend::PostResize(WindowHandle window)
+{
+	WindowMessage message = {};
+	message.type = WINDOW_MESSAGE_SIZE;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_windows.find(window);
+		if (it == m_windows.end())
+			return;
+		const Window& target = it->second;
+		const WindowRect frame = AdjustRect({ 0, 0, 0, 0 }, target.style, target.exStyle, GetWindowDpiLocked(target));
+		message.minimized = target.minimized;
+		message.rect = { 0, 0, target.rect.Width() - frame.Width(), target.rect.Height() - frame.Height() };
+	}
+	DeliverMessage(window, message);
+}
+
+void SimulatedBackend::PostMove(WindowHandle window)
+{
+	WindowMessage message = {};
+	message.type = WINDOW_MESSAGE_MOVE;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_windows.find(window);
+		if (it == m_windows.end())
+			return;
+		const Window& target = it->second;
+		const WindowRect frame = AdjustRect({ 0, 0, 0, 0 }, target.style, target.exStyle, GetWindowDpiLocked(target));
+		const int x = target.rect.left - frame.left;
+		const int y = target.rect.top - frame.top;
+		message.rect = { x, y, x, y };
+	}
+	DeliverMessage(window, message);
+}
+
+int SimulatedBackend::SetThreadDpiAwareness(int awareness)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_threadAwareness[std::this_thread::get_id()] = awareness;
+	return awareness;
+}
+
+int SimulatedBackend::GetThreadDpiAwareness()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_threadAwareness.find(std::this_thread::get_id());
+	return it != m_threadAwareness.end() ? it->second : BW_DPI_UNAWARE;
+}
+
+int SimulatedBackend::GetWindowDpiAwareness(WindowHandle window)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_windows.find(window);
+	return it != m_windows.end() ? it->second.dpiAwareness : BW_DPI_UNAWARE;
+}
+
+unsigned int SimulatedBackend::GetWindowDpi(WindowHandle window)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_windows.find(window);
+	return it != m_windows.end() ? GetWindowDpiLocked(it->second) : BW_DEFAULT_DPI;
+}
+
+unsigned int SimulatedBackend::GetWindowDpiLocked(const Window& window)
+{
+	// The simulated system DPI is the default one.
+	if (window.dpiAwareness < BW_DPI_PER_MONITOR_AWARE)
+		return BW_DEFAULT_DPI;
+	const int x = window.rect.left + window.rect.Width() / 2;
+	const int y = window.rect.top + window.rect.Height() / 2;
+	for (const MonitorInfo& monitor : m_monitors)
+	{
+		if (x >= monitor.rect.left && x < monitor.rect.right && y >= monitor.rect.top && y < monitor.rect.bottom)
+			return monitor.dpi ? monitor.dpi : BW_DEFAULT_DPI;
+	}
+	return BW_DEFAULT_DPI;
+}
+
+uint64_t SimulatedBackend::GetTime()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_time;
+}
+
+void SimulatedBackend::Sleep(unsigned int milliseconds)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_calls.sleep++;
+	AdvanceTimeLocked(milliseconds * 1000ull);
+}
+
+void SimulatedBackend::PostMessage(WindowHandle window, const char* name, const WindowRect& rect)
+{
+	m_messages.push_back(Message{ m_time, window, name, rect });
+}
+
+void SimulatedBackend::NotifyDisplayChange()
+{
+	std::function<void()> callback;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		callback = m_displayChange;
+	}
+	if (callback)
+		callback();
+}
+
+void SimulatedBackend::AdvanceTimeLocked(uint64_t microseconds)
+{
+	m_time += microseconds;
+	for (auto it = m_scheduled.begin(); it != m_scheduled.end();)
+	{
+		if (it->time > m_time)
+		{
+			++it;
+			continue;
+		}
+		m_windows[it->window] = it->state;
+		PostMessage(it->window, "WM_SIZE");
+		it = m_scheduled.erase(it);
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include "window_backend.h"
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// In-memory window system for tests and benchmarks. Windows, monitors and styles are plain
+// data, time is a virtual clock that only moves when a call costs something or someone sleeps,
+// so runs are deterministic and never wait for real.
+class SimulatedBackend : public WindowBackend
+{
+public:
+	struct Window
+	{
+		uint32_t style;
+		uint32_t exStyle;
+		WindowRect rect;
+		bool topmost = false;
+		bool minimized = false;
+		bool exclusiveFullscreen = false;
+		// The creating thread's awareness.
+		int dpiAwareness = BW_DPI_UNAWARE;
+	};
+
+	struct Message
+	{
+		uint64_t time;
+		WindowHandle window;
+		std::string name;
+		// Client size the game received with a WM_SIZE.
+		WindowRect rect;
+	};
+
+	// Per-call counters, used to measure how much window system work a transition costs.
+	struct Calls
+	{
+		int setStyle;
+		int setExStyle;
+		int adjustRect;
+		int setPos;
+		int frameChanged;
+		int getState;
+		int sleep;
+
+		int Total() const { return setStyle + setExStyle + adjustRect + setPos + sleep; }
+	};
+
+	SimulatedBackend();
+
+	// Reported to the game window callback, like the engine creating its window would be.
+	WindowHandle CreateGameWindow(const WindowRect& rect, uint32_t style, uint32_t exStyle);
+	void DestroyWindow(WindowHandle window);
+	// Reports an existing game window again, like the Win32 event thread does when it starts.
+	void ReportGameWindow(WindowHandle window);
+	// A newly created game window starts in the foreground.
+	void SetForeground(WindowHandle window);
+
+	// Monitor changes are reported to the display change callback, like a hot-plug would be.
+	MonitorHandle AddMonitor(const WindowRect& rect);
+	MonitorHandle AddMonitorInfo(const MonitorInfo& info);
+	void RemoveMonitor(MonitorHandle monitor);
+	void UpdateMonitor(const MonitorInfo& info);
+	int GetQueryCount();
+	// Device names by adapter ordinal. Without this, adapters follow monitor order.
+	void SetAdapterDevices(const std::vector<std::string>& devices);
+
+	// Delivers a message to the game window the way the system would, through the message hook.
+	// Messages the game receives are logged with GetMessages. Returns false when the hook
+	// swallowed it.
+	bool DeliverMessage(WindowHandle window, const WindowMessage& message);
+
+	// False while the backdrop is hidden.
+	bool GetBackdrop(WindowRect& rect);
+	Window GetWindow(WindowHandle window);
+	// The calling thread's awareness, BW_DPI_UNAWARE until SetThreadDpiAwareness.
+	int GetThreadDpiAwareness();
+	std::vector<Message> GetMessages();
+	Calls GetCalls();
+	void ResetCounters();
+
+	// Replaces the window state once virtual time reaches `time`, the way the engine restyles
+	// and resizes the window on its own while it resets the device.
+	void ScheduleWindowState(WindowHandle window, uint64_t time, const Window& state);
+	void AdvanceTime(uint64_t microseconds);
+	// Virtual cost of a SetWindowPos call, standing in for the engine answering the resulting messages.
+	void SetPosCost(uint64_t microseconds);
+
+	WindowHandle FindGameWindow() override;
+	void SetGameWindowCallback(std::function<void(WindowHandle)> callback) override;
+	bool IsWindowValid(WindowHandle window) override;
+	bool IsForegroundWindow(WindowHandle window) override;
+	bool SetMessageHook(WindowHandle window, std::function<bool(WindowMessage&)> hook) override;
+	std::vector<MonitorInfo> QueryMonitors() override;
+	std::vector<std::string> QueryAdapterDevices() override;
+	WindowRect GetDesktopRect() override;
+	void SetDisplayChangeCallback(std::function<void()> callback) override;
+
+	void SetWindowStyle(WindowHandle window, uint32_t style) override;
+	void SetWindowExStyle(WindowHandle window, uint32_t exStyle) override;
+	WindowRect AdjustWindowRect(const WindowRect& client, uint32_t style, uint32_t exStyle, unsigned int dpi) override;
+	void SetWindowPos(WindowHandle window, WindowZOrder order, int x, int y, int width, int height, bool frameChanged) override;
+	bool GetWindowState(WindowHandle window, WindowState& state) override;
+	void PostResize(WindowHandle window) override;
+	void PostMove(WindowHandle window) override;
+	void SetBackdrop(WindowHandle window, const WindowRect* rect) override;
+
+	int SetThreadDpiAwareness(int awareness) override;
+	int GetWindowDpiAwareness(WindowHandle window) override;
+	unsigned int GetWindowDpi(WindowHandle window) override;
+
+	// Virtual time in microseconds.
+	uint64_t GetTime() override;
+	void Sleep(unsigned int milliseconds) override;
+
+private:
+	struct ScheduledState
+	{
+		uint64_t time;
+		WindowHandle window;
+		Window state;
+	};
+
+	void PostMessage(WindowHandle window, const char* name, const WindowRect& rect = WindowRect());
+	void AdvanceTimeLocked(uint64_t microseconds);
+	unsigned int GetWindowDpiLocked(const Window& window);
+	void NotifyDisplayChange();
+
+	std::mutex m_mutex;
+	std::map<WindowHandle, Window> m_windows;
+	WindowHandle m_gameWindow;
+	std::vector<MonitorInfo> m_monitors;
+	std::vector<std::string> m_adapters;
+	std::function<void()> m_displayChange;
+	std::function<void(WindowHandle)> m_gameWindowCreated;
+	WindowHandle m_hookedWindow;
+	WindowHandle m_foreground;
+	std::function<bool(WindowMessage&)> m_messageHook;
+	bool m_backdropShown;
+	WindowRect m_backdropRect;
+	std::map<std::thread::id, int> m_threadAwareness;
+	int m_queries;
+	std::vector<Message> m_messages;
+	std::vector<ScheduledState> m_scheduled;
+	Calls m_calls;
+	uint64_t m_time;
+	uint64_t m_posCost;
+	uintptr_t m_nextHandle;
+};
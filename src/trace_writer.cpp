@@ -0,0 +1,118 @@
+#include "trace_writer.h"
+#include <chrono>
+
+// Flushing this often keeps a trace of a crash or a hang mostly intact.
+static const std::chrono::milliseconds kFlushInterval(250);
+
+static const char* kThreadNames[] = { nullptr, "game", "transition worker", "window events" };
+
+TraceWriter::TraceWriter()
+	: m_enabled(false), m_dropped(0), m_stop(false), m_file(nullptr), m_first(true)
+{
+}
+
+TraceWriter::~TraceWriter()
+{
+	Stop();
+}
+
+bool TraceWriter::Start(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_thread.joinable())
+		return false;
+	m_file = std::fopen(path.c_str(), "w");
+	if (!m_file)
+		return false;
+	std::fputs("[\n", m_file);
+	m_first = true;
+	m_stop = false;
+	m_pending.clear();
+	m_dropped = 0;
+	for (int thread = TRACE_THREAD_GAME; thread <= TRACE_THREAD_WINDOW; thread++)
+	{
+		TraceEvent event = { 'M', thread, "", "thread_name", 0, 0, std::string("\"name\":\"") + kThreadNames[thread] + "\"" };
+		m_pending.push_back(event);
+	}
+	m_thread = std::thread(&TraceWriter::Run, this);
+	m_enabled = true;
+	return true;
+}
+
+void TraceWriter::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_enabled = false;
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void TraceWriter::Complete(int thread, const char* category, const char* name, uint64_t start, uint64_t duration, std::string args)
+{
+	if (IsEnabled())
+		Add({ 'X', thread, category, name, start, duration, std::move(args) });
+}
+
+void TraceWriter::Instant(int thread, const char* category, const char* name, uint64_t time, std::string args)
+{
+	if (IsEnabled())
+		Add({ 'i', thread, category, name, time, 0, std::move(args) });
+}
+
+void TraceWriter::Add(TraceEvent&& event)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_enabled)
+		return;
+	if (m_pending.size() >= kMaxPending)
+	{
+		m_dropped++;
+		return;
+	}
+	m_pending.push_back(std::move(event));
+}
+
+void TraceWriter::Run()
+{
+	std::vector<TraceEvent> events;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_wake.wait_for(lock, kFlushInterval, [this] { return m_stop; });
+		const bool stop = m_stop;
+		events.swap(m_pending);
+		lock.unlock();
+
+		Write(events);
+		events.clear();
+		std::fflush(m_file);
+
+		lock.lock();
+		if (stop)
+			break;
+	}
+	std::fputs("\n]\n", m_file);
+	std::fclose(m_file);
+	m_file = nullptr;
+}
+
+void TraceWriter::Write(const std::vector<TraceEvent>& events)
+{
+	for (const TraceEvent& event : events)
+	{
+		std::fprintf(m_file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%llu", m_first ? "" : ",\n",
+			event.name, event.category, event.phase, event.thread, (unsigned long long)event.time);
+		if (event.phase == 'X')
+			std::fprintf(m_file, ",\"dur\":%llu", (unsigned long long)event.duration);
+		else if (event.phase == 'i')
+			std::fputs(",\"s\":\"t\"", m_file);
+		if (!event.args.empty())
+			std::fprintf(m_file, ",\"args\":{%s}", event.args.c_str());
+		std::fputc('}', m_file);
+		m_first = false;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Track ids the events are grouped by in the viewer.
+enum TraceThread
+{
+	TRACE_THREAD_GAME = 1,
+	TRACE_THREAD_WORKER = 2,
+	TRACE_THREAD_WINDOW = 3
+};
+
+struct TraceEvent
+{
+	// 'X' for a complete event with a duration, 'i' for an instant.
+	char phase;
+	int thread;
+	// Static strings only, they are stored by pointer.
+	const char* category;
+	const char* name;
+	uint64_t time;
+	uint64_t duration;
+	// Body of the event's args object, e.g. "\"mode\":2", or empty.
+	std::string args;
+};
+
+// Chrome trace (JSON array format) writer, loadable in chrome://tracing and Perfetto. Events
+// are appended to an in-memory buffer under a lock that is only held for the push; a
+// background thread swaps the buffer out and does all the formatting and file I/O.
+class TraceWriter
+{
+public:
+	// Events beyond this many pending are dropped rather than growing without bound.
+	static const size_t kMaxPending = 65536;
+
+	TraceWriter();
+	~TraceWriter();
+
+	bool Start(const std::string& path);
+	// Flushes everything and closes the file.
+	void Stop();
+	bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+	uint64_t GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+	// Times in microseconds. Calls are ignored while the writer is not started.
+	void Complete(int thread, const char* category, const char* name, uint64_t start, uint64_t duration, std::string args = std::string());
+	void Instant(int thread, const char* category, const char* name, uint64_t time, std::string args = std::string());
+
+private:
+	void Add(TraceEvent&& event);
+	void Run();
+	void Write(const std::vector<TraceEvent>& events);
+
+	std::atomic<bool> m_enabled;
+	std::atomic<uint64_t> m_dropped;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::vector<TraceEvent> m_pending;
+	bool m_stop;
+	std::thread m_thread;
+	// Only touched by the flush thread while it runs.
+	std::FILE* m_file;
+	bool m_first;
+};
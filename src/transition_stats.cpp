@@ -0,0 +1,93 @@
+#include "transition_stats.h"
+
+static const char* kStageNames[TRANSITION_STAGE_COUNT] = {
+	"dispatch",
+	"ready_wait",
+	"style",
+	"adjust_rect",
+	"set_pos",
+	"complete"
+};
+
+const char* GetTransitionStageName(int stage)
+{
+	return stage >= 0 && stage < TRANSITION_STAGE_COUNT ? kStageNames[stage] : "unknown";
+}
+
+TransitionTimeline::TransitionTimeline(WindowBackend& backend, uint64_t received)
+	: m_backend(backend), m_received(received), m_marks(), m_marked()
+{
+}
+
+void TransitionTimeline::Mark(TransitionStage stage)
+{
+	m_marks[stage] = m_backend.GetTime();
+	m_marked[stage] = true;
+}
+
+uint64_t TransitionTimeline::GetDuration(int stage) const
+{
+	if (!Has(stage))
+		return 0;
+	uint64_t previous = m_received;
+	for (int i = stage - 1; i >= 0; i--)
+	{
+		if (Has(i))
+		{
+			previous = m_marks[i];
+			break;
+		}
+	}
+	return m_marks[stage] > previous ? m_marks[stage] - previous : 0;
+}
+
+uint64_t TransitionTimeline::GetTotal() const
+{
+	for (int i = TRANSITION_STAGE_COUNT - 1; i >= 0; i--)
+	{
+		if (Has(i))
+			return m_marks[i] > m_received ? m_marks[i] - m_received : 0;
+	}
+	return 0;
+}
+
+void DurationStats::Add(uint64_t us)
+{
+	if (count == 0 || us < minUs)
+		minUs = us;
+	if (us > maxUs)
+		maxUs = us;
+	lastUs = us;
+	totalUs += us;
+	count++;
+}
+
+void TransitionStats::Record(int mode, const TransitionTimeline& timeline)
+{
+	if (mode < 0 || mode >= kModeCount)
+		return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	ModeTransitionStats& stats = m_modes[mode];
+	stats.total.Add(timeline.GetTotal());
+	for (int i = 0; i < TRANSITION_STAGE_COUNT; i++)
+	{
+		if (timeline.Has(i))
+			stats.stages[i].Add(timeline.GetDuration(i));
+	}
+}
+
+bool TransitionStats::Get(int mode, ModeTransitionStats& stats)
+{
+	if (mode < 0 || mode >= kModeCount)
+		return false;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	stats = m_modes[mode];
+	return true;
+}
+
+void TransitionStats::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (ModeTransitionStats& stats : m_modes)
+		stats = ModeTransitionStats();
+}
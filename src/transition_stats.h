@@ -0,0 +1,87 @@
+#pragma once
+#include "window_backend.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+enum TransitionStage
+{
+	// Request received in ChangeDisplayMode until the worker picks it up.
+	TRANSITION_STAGE_DISPATCH = 0,
+	// Waiting for the engine to finish its own reset.
+	TRANSITION_STAGE_READY_WAIT,
+	// SetWindowLong for the style and the extended style.
+	TRANSITION_STAGE_STYLE,
+	TRANSITION_STAGE_ADJUST_RECT,
+	TRANSITION_STAGE_SET_POS,
+	TRANSITION_STAGE_COMPLETE,
+	TRANSITION_STAGE_COUNT
+};
+
+const char* GetTransitionStageName(int stage);
+
+// Timestamps of a single transition. Each stage is marked when it ends; a stage that did not
+// happen (no ready wait in Windowed, say) is simply never marked.
+class TransitionTimeline
+{
+public:
+	TransitionTimeline(WindowBackend& backend, uint64_t received);
+
+	void Mark(TransitionStage stage);
+	bool Has(int stage) const { return m_marked[stage]; }
+	uint64_t GetReceived() const { return m_received; }
+	// When the stage ended, only meaningful if it was marked.
+	uint64_t GetTime(int stage) const { return m_marks[stage]; }
+	// Time spent in a stage, measured from the end of the previous marked stage.
+	uint64_t GetDuration(int stage) const;
+	uint64_t GetTotal() const;
+
+private:
+	WindowBackend& m_backend;
+	uint64_t m_received;
+	uint64_t m_marks[TRANSITION_STAGE_COUNT];
+	bool m_marked[TRANSITION_STAGE_COUNT];
+};
+
+struct DurationStats
+{
+	uint64_t count;
+	uint64_t totalUs;
+	uint64_t minUs;
+	uint64_t maxUs;
+	uint64_t lastUs;
+
+	void Add(uint64_t us);
+};
+
+// Nearest-rank percentile of values sorted in ascending order, 0 when there are none.
+template <typename T>
+uint64_t Percentile(const std::vector<T>& sorted, double percentile)
+{
+	if (sorted.empty())
+		return 0;
+	size_t rank = (size_t)(percentile / 100.0 * sorted.size() + 0.5);
+	rank = std::min(std::max(rank, (size_t)1), sorted.size());
+	return sorted[rank - 1];
+}
+
+struct ModeTransitionStats
+{
+	DurationStats total;
+	DurationStats stages[TRANSITION_STAGE_COUNT];
+};
+
+// Per display mode aggregate of every transition the worker ran.
+class TransitionStats
+{
+public:
+	static const int kModeCount = 3;
+
+	void Record(int mode, const TransitionTimeline& timeline);
+	bool Get(int mode, ModeTransitionStats& stats);
+	void Reset();
+
+private:
+	std::mutex m_mutex;
+	ModeTransitionStats m_modes[kModeCount] = {};
+};
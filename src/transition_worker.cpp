@@ -0,0 +1,253 @@
+#include "transition_worker.h"
+#include <cstdio>
+
+static const size_t kMaxTransactions = 4;
+static const size_t kMaxResults = 64;
+
+TransitionWorker::TransitionWorker(DisplayModeController& controller)
+	: m_controller(controller), m_pending(), m_hasPending(false), m_deferred(), m_hasDeferred(false), m_busy(false), m_stop(false), m_pendingCoalesced(0), m_callsSinceResult(0), m_nextRequest(1), m_latestMode(-1), m_counters(), m_nextTransaction(1)
+{
+}
+
+TransitionWorker::~TransitionWorker()
+{
+	Stop();
+}
+
+void TransitionWorker::Start()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_thread.joinable())
+		return;
+	m_stop = false;
+	m_thread = std::thread(&TransitionWorker::Run, this);
+}
+
+void TransitionWorker::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+uint64_t TransitionWorker::Submit(const TransitionRequest& request)
+{
+	const uint64_t now = m_controller.GetBackend().GetTime();
+	uint64_t id;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_counters.submitted++;
+		if (m_hasPending)
+		{
+			m_counters.coalesced++;
+			m_pendingCoalesced++;
+		}
+		else
+		{
+			m_pendingCoalesced = 0;
+		}
+		id = m_nextRequest++;
+		m_pending = request;
+		m_pending.receivedTime = now;
+		m_pending.id = id;
+		m_hasPending = true;
+		m_hasDeferred = false;
+		m_latestMode = request.restore ? request.snapshot.mode : request.mode;
+	}
+	m_wake.notify_one();
+	TraceWriter* trace = m_controller.GetTrace();
+	if (trace && trace->IsEnabled())
+	{
+		char args[128];
+		std::snprintf(args, sizeof(args), "\"id\":%llu,\"mode\":%d,\"width\":%d,\"height\":%d,\"adapter\":%d,\"rollback\":%s",
+			(unsigned long long)id, request.mode, request.width, request.height, request.adapter, request.restore ? "true" : "false");
+		trace->Instant(TRACE_THREAD_GAME, "transition", "change_display_mode", now, args);
+	}
+	return id;
+}
+
+void TransitionWorker::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return (!m_hasPending && !m_busy) || m_stop; });
+}
+
+int TransitionWorker::GetLatestMode()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_latestMode;
+}
+
+uint64_t TransitionWorker::GetActiveRequest()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	// A running request is the newest one unless another is pending, and a newer one would be.
+	return m_hasPending || m_busy ? m_nextRequest - 1 : 0;
+}
+
+TransitionWorker::Counters TransitionWorker::GetCounters()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_counters;
+}
+
+void TransitionWorker::NoteRenderSettingsApplied()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_counters.renderSettingsCalls++;
+	m_callsSinceResult++;
+}
+
+void TransitionWorker::TakeResults(std::vector<TransitionResult>& results)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	results.assign(m_results.begin(), m_results.end());
+	m_results.clear();
+}
+
+bool TransitionWorker::HasDeferred()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_hasDeferred;
+}
+
+bool TransitionWorker::ResumeDeferred()
+{
+	const uint64_t now = m_controller.GetBackend().GetTime();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_hasDeferred || m_hasPending)
+			return false;
+		m_pending = m_deferred;
+		m_pending.receivedTime = now;
+		m_pendingCoalesced = 0;
+		m_hasPending = true;
+		m_hasDeferred = false;
+	}
+	m_wake.notify_one();
+	return true;
+}
+
+int TransitionWorker::BeginTransaction()
+{
+	WindowSnapshot snapshot;
+	if (!m_controller.CaptureSnapshot(snapshot))
+		return 0;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const int id = m_nextTransaction++;
+	m_transactions[id] = snapshot;
+	while (m_transactions.size() > kMaxTransactions)
+		m_transactions.erase(m_transactions.begin());
+	return id;
+}
+
+bool TransitionWorker::CommitTransaction(int id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_transactions.erase(id) != 0;
+}
+
+bool TransitionWorker::RollbackTransaction(int id)
+{
+	TransitionRequest request = {};
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_transactions.find(id);
+		if (it == m_transactions.end())
+			return false;
+		request.restore = true;
+		request.snapshot = it->second;
+		request.mode = it->second.mode;
+		m_transactions.erase(it);
+	}
+	Submit(request);
+	return true;
+}
+
+static void TraceTransition(TraceWriter* trace, const TransitionTimeline& timeline, const TransitionResult& result)
+{
+	if (!trace || !trace->IsEnabled())
+		return;
+	char args[128];
+	std::snprintf(args, sizeof(args), "\"id\":%llu,\"mode\":%d,\"success\":%s,\"coalesced\":%llu", (unsigned long long)result.id,
+		result.mode, result.success ? "true" : "false", (unsigned long long)result.coalesced);
+	trace->Complete(TRACE_THREAD_WORKER, "transition", "transition", timeline.GetReceived(), timeline.GetTotal(), args);
+	for (int stage = 0; stage < TRANSITION_STAGE_COUNT; stage++)
+	{
+		if (!timeline.Has(stage))
+			continue;
+		const uint64_t duration = timeline.GetDuration(stage);
+		trace->Complete(TRACE_THREAD_WORKER, "stage", GetTransitionStageName(stage), timeline.GetTime(stage) - duration, duration);
+	}
+}
+
+void TransitionWorker::Run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_wake.wait(lock, [this] { return m_hasPending || m_stop; });
+		if (m_stop)
+			break;
+		const TransitionRequest request = m_pending;
+		const uint64_t coalesced = m_pendingCoalesced;
+		m_hasPending = false;
+		m_busy = true;
+		lock.unlock();
+
+		TransitionTimeline timeline(m_controller.GetBackend(), request.receivedTime);
+		timeline.Mark(TRANSITION_STAGE_DISPATCH);
+		TransitionResult result = {};
+		result.id = request.id;
+		result.restore = request.restore;
+		result.coalesced = coalesced;
+		if (request.restore)
+		{
+			result.mode = request.snapshot.mode;
+			result.success = m_controller.Restore(request.snapshot, &timeline);
+		}
+		else
+		{
+			result.mode = request.mode;
+			const DisplayConfig config = { request.mode, request.width, request.height, request.adapter, request.positioned, request.x, request.y, request.scaling };
+			result.success = m_controller.ApplyDisplayConfig(config, &timeline);
+		}
+		timeline.Mark(TRANSITION_STAGE_COMPLETE);
+		if (result.success)
+		{
+			m_stats.Record(result.mode, timeline);
+		}
+		else
+		{
+			result.error = m_controller.GetLastError();
+			result.deferred = m_controller.IsDeferred();
+		}
+		WindowState state;
+		if (m_controller.GetBackend().GetWindowState(m_controller.GetWindow(), state))
+			result.rect = state.rect;
+		result.elapsedUs = timeline.GetTotal();
+		TraceTransition(m_controller.GetTrace(), timeline, result);
+
+		lock.lock();
+		m_busy = false;
+		m_counters.executed++;
+		result.renderSettingsCalls = m_callsSinceResult;
+		m_callsSinceResult = 0;
+		if (result.deferred && !m_hasPending)
+		{
+			m_deferred = request;
+			m_hasDeferred = true;
+		}
+		m_results.push_back(result);
+		while (m_results.size() > kMaxResults)
+			m_results.pop_front();
+		if (!m_hasPending)
+			m_idle.notify_all();
+	}
+	m_busy = false;
+	m_idle.notify_all();
+}
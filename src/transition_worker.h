@@ -0,0 +1,123 @@
+#pragma once
+#include "display_mode.h"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+struct TransitionRequest
+{
+	int mode;
+	int width = 0;
+	int height = 0;
+	int adapter = 0;
+	// Stamped by Submit, the start of the transition's timeline.
+	uint64_t receivedTime = 0;
+	// Put the window back as captured instead of applying a mode.
+	bool restore = false;
+	WindowSnapshot snapshot = {};
+	// Assigned by Submit.
+	uint64_t id = 0;
+	// Window position in windowed mode, see DisplayConfig.
+	bool positioned = false;
+	int x = 0;
+	int y = 0;
+	// Scaled fullscreen windowed, see DisplayConfig.
+	int scaling = PRESENT_SCALING_NONE;
+};
+
+// What became of an executed request, handed back to the game thread.
+struct TransitionResult
+{
+	uint64_t id;
+	int mode;
+	bool restore;
+	bool success;
+	// The window rect once the transition finished.
+	WindowRect rect;
+	uint64_t elapsedUs;
+	// Requests this one replaced while it was pending.
+	uint64_t coalesced;
+	// Calls to Application:apply_render_settings reported since the previous result. This is a
+	// call count, not a device reset count: the engine resets its device from there, but not on
+	// every call, and no reset event reaches the plugin.
+	uint64_t renderSettingsCalls;
+	// Failed on something transient with the window untouched, see ResumeDeferred.
+	bool deferred;
+	std::string error;
+};
+
+// Single long-lived thread that performs every transition. It is the only thread touching the
+// controller once started, and it keeps just the newest pending request: a burst of calls from
+// Lua costs one transition instead of one racing thread each.
+class TransitionWorker
+{
+public:
+	struct Counters
+	{
+		uint64_t submitted;
+		uint64_t coalesced;
+		uint64_t executed;
+		uint64_t renderSettingsCalls;
+	};
+
+	explicit TransitionWorker(DisplayModeController& controller);
+	~TransitionWorker();
+
+	void Start();
+	void Stop();
+
+	// Returns the id the request's result will carry.
+	uint64_t Submit(const TransitionRequest& request);
+	// Mode of the newest submitted request, pending or not, -1 before the first.
+	int GetLatestMode();
+	// Id of the newest request while it is pending or running, 0 once the worker is idle.
+	uint64_t GetActiveRequest();
+	// Blocks until nothing is pending or running. Used by tests and benchmarks.
+	void WaitIdle();
+	Counters GetCounters();
+	TransitionStats& GetStats() { return m_stats; }
+	// Records a call to Application:apply_render_settings, see TransitionResult.
+	void NoteRenderSettingsApplied();
+	// Moves out the results of the transitions executed since the last call, oldest first.
+	void TakeResults(std::vector<TransitionResult>& results);
+	// A deferred request is kept until a newer one is submitted. The game thread resumes it
+	// once whatever deferred it has cleared; it runs again under its original id.
+	bool HasDeferred();
+	bool ResumeDeferred();
+
+	// Captures the window before a change the user may decline. Returns the transaction id, or 0
+	// when the window could not be read.
+	int BeginTransaction();
+	// Forgets the captured state.
+	bool CommitTransaction(int id);
+	// Queues a restore of the captured state. Like any request it replaces whatever is pending.
+	bool RollbackTransaction(int id);
+
+private:
+	void Run();
+
+	DisplayModeController& m_controller;
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_idle;
+	TransitionRequest m_pending;
+	bool m_hasPending;
+	TransitionRequest m_deferred;
+	bool m_hasDeferred;
+	bool m_busy;
+	bool m_stop;
+	uint64_t m_pendingCoalesced;
+	uint64_t m_callsSinceResult;
+	uint64_t m_nextRequest;
+	int m_latestMode;
+	Counters m_counters;
+	TransitionStats m_stats;
+	// Nobody may be collecting them, so only the newest are kept.
+	std::deque<TransitionResult> m_results;
+	// Lua commits or rolls back each one, the cap only guards against a dialog that never closed.
+	std::map<int, WindowSnapshot> m_transactions;
+	int m_nextTransaction;
+};
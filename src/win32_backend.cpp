@@ -0,0 +1,576 @@
+#include "win32_backend.h"
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <shellapi.h>
+#include <d3d9.h>
+#include <string>
+
+static_assert(BW_WS_POPUP == WS_POPUP && BW_WS_VISIBLE == WS_VISIBLE && BW_WS_CAPTION == WS_CAPTION, "Style bits out of sync with windows.h");
+static_assert(BW_WS_EX_OVERLAPPEDWINDOW == WS_EX_OVERLAPPEDWINDOW, "Style bits out of sync with windows.h");
+static_assert(BW_WS_THICKFRAME == WS_THICKFRAME && BW_WS_EX_LAYERED == WS_EX_LAYERED && BW_WS_EX_TRANSPARENT == WS_EX_TRANSPARENT
+	&& BW_WS_EX_STATICEDGE == WS_EX_STATICEDGE && BW_WS_EX_DLGMODALFRAME == WS_EX_DLGMODALFRAME, "Style bits out of sync with windows.h");
+
+static RECT ToRECT(const WindowRect& rect)
+{
+	return RECT{ rect.left, rect.top, rect.right, rect.bottom };
+}
+
+static WindowRect FromRECT(const RECT& rect)
+{
+	return WindowRect{ rect.left, rect.top, rect.right, rect.bottom };
+}
+
+static std::string ToUTF8(const wchar_t* text)
+{
+	const int length = WideCharToMultiByte(CP_UTF8, 0, text, -1, NULL, 0, NULL, NULL);
+	if (length <= 1)
+		return std::string();
+	std::string result(length - 1, '\0');
+	WideCharToMultiByte(CP_UTF8, 0, text, -1, &result[0], length, NULL, NULL);
+	return result;
+}
+
+// The DPI awareness contexts and the *ForDpi functions need Windows 10 1607, the process
+// awareness functions of shcore.dll Windows 8.1.
+static FARPROC GetUser32Proc(const char* name)
+{
+	return GetProcAddress(GetModuleHandleW(L"user32.dll"), name);
+}
+
+static FARPROC GetShcoreProc(const char* name)
+{
+	static const HMODULE shcore = LoadLibraryW(L"shcore.dll");
+	return shcore ? GetProcAddress(shcore, name) : nullptr;
+}
+
+typedef HRESULT(WINAPI* GetDpiForMonitorProc)(HMONITOR, int, UINT*, UINT*);
+
+static unsigned int GetMonitorDpi(HMONITOR hMonitor)
+{
+	static const auto getDpiForMonitor = reinterpret_cast<GetDpiForMonitorProc>(GetShcoreProc("GetDpiForMonitor"));
+	UINT dpiX, dpiY;
+	if (getDpiForMonitor && SUCCEEDED(getDpiForMonitor(hMonitor, 0 /* MDT_EFFECTIVE_DPI */, &dpiX, &dpiY)))
+		return dpiX;
+	HDC hdc = GetDC(NULL);
+	const int dpi = GetDeviceCaps(hdc, LOGPIXELSX);
+	ReleaseDC(NULL, hdc);
+	return dpi;
+}
+
+typedef DPI_AWARENESS_CONTEXT(WINAPI* SetThreadDpiAwarenessContextProc)(DPI_AWARENESS_CONTEXT);
+typedef DPI_AWARENESS_CONTEXT(WINAPI* GetThreadDpiAwarenessContextProc)();
+typedef DPI_AWARENESS_CONTEXT(WINAPI* GetWindowDpiAwarenessContextProc)(HWND);
+typedef BOOL(WINAPI* AreDpiAwarenessContextsEqualProc)(DPI_AWARENESS_CONTEXT, DPI_AWARENESS_CONTEXT);
+typedef DPI_AWARENESS(WINAPI* GetAwarenessFromDpiAwarenessContextProc)(DPI_AWARENESS_CONTEXT);
+typedef UINT(WINAPI* GetDpiForWindowProc)(HWND);
+typedef BOOL(WINAPI* AdjustWindowRectExForDpiProc)(LPRECT, DWORD, BOOL, DWORD, UINT);
+typedef HRESULT(WINAPI* GetProcessDpiAwarenessProc)(HANDLE, int*);
+
+static int GetContextAwareness(DPI_AWARENESS_CONTEXT context)
+{
+	const auto areEqual = reinterpret_cast<AreDpiAwarenessContextsEqualProc>(GetUser32Proc("AreDpiAwarenessContextsEqual"));
+	const auto getAwareness = reinterpret_cast<GetAwarenessFromDpiAwarenessContextProc>(GetUser32Proc("GetAwarenessFromDpiAwarenessContext"));
+	if (areEqual(context, DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2))
+		return BW_DPI_PER_MONITOR_AWARE_V2;
+	switch (getAwareness(context))
+	{
+	case DPI_AWARENESS_PER_MONITOR_AWARE:
+		return BW_DPI_PER_MONITOR_AWARE;
+	case DPI_AWARENESS_SYSTEM_AWARE:
+		return BW_DPI_SYSTEM_AWARE;
+	default:
+		return BW_DPI_UNAWARE;
+	}
+}
+
+static int QueryDpiAwareness()
+{
+	if (const auto getContext = reinterpret_cast<GetThreadDpiAwarenessContextProc>(GetUser32Proc("GetThreadDpiAwarenessContext")))
+		return GetContextAwareness(getContext());
+	int awareness;
+	const auto getProcessAwareness = reinterpret_cast<GetProcessDpiAwarenessProc>(GetShcoreProc("GetProcessDpiAwareness"));
+	if (getProcessAwareness && SUCCEEDED(getProcessAwareness(NULL, &awareness)))
+		return awareness >= 2 ? BW_DPI_PER_MONITOR_AWARE : awareness == 1 ? BW_DPI_SYSTEM_AWARE : BW_DPI_UNAWARE;
+	return IsProcessDPIAware() ? BW_DPI_SYSTEM_AWARE : BW_DPI_UNAWARE;
+}
+
+static BOOL CALLBACK MonitorEnumProcCallback(HMONITOR hMonitor, HDC hdc, LPRECT lprcMonitor, LPARAM dwData)
+{
+	MONITORINFOEXW info;
+	info.cbSize = sizeof(MONITORINFOEXW);
+	if (!GetMonitorInfoW(hMonitor, &info))
+		return TRUE;
+	DEVMODEW mode = {};
+	mode.dmSize = sizeof(DEVMODEW);
+	const int refreshRate = EnumDisplaySettingsW(info.szDevice, ENUM_CURRENT_SETTINGS, &mode) ? mode.dmDisplayFrequency : 0;
+	reinterpret_cast<std::vector<MonitorInfo>*>(dwData)->push_back(MonitorInfo{
+		hMonitor,
+		FromRECT(info.rcMonitor),
+		FromRECT(info.rcWork),
+		refreshRate,
+		GetMonitorDpi(hMonitor),
+		(info.dwFlags & MONITORINFOF_PRIMARY) != 0,
+		ToUTF8(info.szDevice) });
+	return TRUE;
+}
+
+// Posted to the event window when the backdrop request changed.
+static const UINT WM_UPDATE_BACKDROP = WM_APP + 1;
+
+static LRESULT CALLBACK EventWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	Win32Backend* backend = reinterpret_cast<Win32Backend*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+	switch (uMsg)
+	{
+	case WM_UPDATE_BACKDROP:
+		if (backend)
+			backend->UpdateBackdrop();
+		return 0;
+	case WM_DISPLAYCHANGE:
+		if (backend)
+			backend->NotifyDisplayChange();
+		break;
+	case WM_SETTINGCHANGE:
+		if (backend && wParam == SPI_SETWORKAREA)
+			backend->NotifyDisplayChange();
+		break;
+	}
+	return DefWindowProc(hWnd, uMsg, wParam, lParam);
+}
+
+// The backend the window creation hook reports to; WinEventProc has no user data.
+static Win32Backend* g_eventBackend = nullptr;
+
+// Our own process's engine window, recognised by class rather than by title so a localised or
+// renamed title does not matter, and another running game instance is never picked up.
+static bool IsGameWindow(HWND hWnd)
+{
+	DWORD processId = 0;
+	GetWindowThreadProcessId(hWnd, &processId);
+	if (processId != GetCurrentProcessId() || GetParent(hWnd) != NULL)
+		return false;
+	wchar_t className[32];
+	return GetClassNameW(hWnd, className, ARRAYSIZE(className)) && wcscmp(className, L"diesel win32") == 0;
+}
+
+static BOOL CALLBACK FindGameWindowCallback(HWND hWnd, LPARAM lParam)
+{
+	if (!IsGameWindow(hWnd))
+		return TRUE;
+	*reinterpret_cast<HWND*>(lParam) = hWnd;
+	return FALSE;
+}
+
+static void CALLBACK WindowCreatedProc(HWINEVENTHOOK hook, DWORD event, HWND hWnd, LONG idObject, LONG idChild, DWORD idEventThread, DWORD dwmsEventTime)
+{
+	if (idObject == OBJID_WINDOW && idChild == CHILDID_SELF && hWnd && g_eventBackend && IsGameWindow(hWnd))
+		g_eventBackend->NotifyWindowCreated(hWnd);
+}
+
+Win32Backend::Win32Backend()
+	: m_eventWindow(nullptr), m_backdropWindow(nullptr), m_backdropAfter(nullptr), m_backdropShown(false), m_backdropRect()
+{
+}
+
+WindowHandle Win32Backend::FindGameWindow()
+{
+	HWND hWnd = NULL;
+	EnumWindows(FindGameWindowCallback, reinterpret_cast<LPARAM>(&hWnd));
+	return hWnd;
+}
+
+void Win32Backend::SetGameWindowCallback(std::function<void(WindowHandle)> callback)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		m_gameWindowCreated = std::move(callback);
+	}
+	StartEventThread();
+}
+
+bool Win32Backend::IsWindowValid(WindowHandle window)
+{
+	HWND hWnd = static_cast<HWND>(window);
+	DWORD processId = 0;
+	return IsWindow(hWnd) && GetWindowThreadProcessId(hWnd, &processId) && processId == GetCurrentProcessId();
+}
+
+// The game window is subclassed at most once at a time. Its original procedure is kept here so
+// messages the hook lets through reach the engine unchanged.
+static Win32Backend* g_hookBackend = nullptr;
+static HWND g_hookedWindow = NULL;
+static WNDPROC g_gameWindowProc = NULL;
+
+static bool ToWindowMessage(UINT uMsg, WPARAM wParam, LPARAM lParam, WindowMessage& message)
+{
+	message = WindowMessage();
+	switch (uMsg)
+	{
+	case WM_ACTIVATEAPP:
+		message.type = WINDOW_MESSAGE_ACTIVATE_APP;
+		message.active = wParam != FALSE;
+		return true;
+	case WM_SIZE:
+		message.type = WINDOW_MESSAGE_SIZE;
+		message.minimized = wParam == SIZE_MINIMIZED;
+		message.rect = { 0, 0, LOWORD(lParam), HIWORD(lParam) };
+		return true;
+	case WM_WINDOWPOSCHANGED:
+	{
+		const WINDOWPOS* position = reinterpret_cast<const WINDOWPOS*>(lParam);
+		message.type = WINDOW_MESSAGE_WINDOW_POS_CHANGED;
+		message.rect = { position->x, position->y, position->x + position->cx, position->y + position->cy };
+		return true;
+	}
+	case WM_MOVE:
+		message.type = WINDOW_MESSAGE_MOVE;
+		message.rect = { (short)LOWORD(lParam), (short)HIWORD(lParam), (short)LOWORD(lParam), (short)HIWORD(lParam) };
+		return true;
+	case WM_SYSCOMMAND:
+		if ((wParam & 0xFFF0) != SC_MINIMIZE)
+			return false;
+		message.type = WINDOW_MESSAGE_MINIMIZE_COMMAND;
+		return true;
+	}
+	return false;
+}
+
+static LRESULT CALLBACK GameWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	WindowMessage message;
+	if (g_hookBackend && ToWindowMessage(uMsg, wParam, lParam, message))
+	{
+		if (g_hookBackend->RunMessageHook(message))
+			return 0;
+		// Only the client size of a WM_SIZE can be rewritten.
+		if (uMsg == WM_SIZE)
+			lParam = MAKELPARAM(message.rect.Width(), message.rect.Height());
+	}
+	return CallWindowProcW(g_gameWindowProc, hWnd, uMsg, wParam, lParam);
+}
+
+bool Win32Backend::SetMessageHook(WindowHandle window, std::function<bool(WindowMessage&)> hook)
+{
+	HWND hWnd = static_cast<HWND>(window);
+	if (!IsWindowValid(window))
+		return false;
+	// The subclass statics are only written here, so one lock keeps two installs from chaining
+	// the window procedure to itself.
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	m_messageHook = std::move(hook);
+	if (hWnd == g_hookedWindow)
+		return true;
+	// A window the engine replaced keeps getting its messages from the old procedure.
+	if (g_hookedWindow && IsWindow(g_hookedWindow))
+		SetWindowLongPtrW(g_hookedWindow, GWLP_WNDPROC, reinterpret_cast<LONG_PTR>(g_gameWindowProc));
+	g_hookBackend = this;
+	WNDPROC previous = reinterpret_cast<WNDPROC>(SetWindowLongPtrW(hWnd, GWLP_WNDPROC, reinterpret_cast<LONG_PTR>(GameWindowProc)));
+	if (!previous || previous == GameWindowProc)
+		return previous != NULL;
+	g_gameWindowProc = previous;
+	g_hookedWindow = hWnd;
+	return true;
+}
+
+bool Win32Backend::RunMessageHook(WindowMessage& message)
+{
+	std::function<bool(WindowMessage&)> hook;
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		hook = m_messageHook;
+	}
+	return hook && hook(message);
+}
+
+bool Win32Backend::IsForegroundWindow(WindowHandle window)
+{
+	return window && GetForegroundWindow() == static_cast<HWND>(window);
+}
+
+void Win32Backend::NotifyWindowCreated(WindowHandle window)
+{
+	std::function<void(WindowHandle)> callback;
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		callback = m_gameWindowCreated;
+	}
+	if (callback)
+		callback(window);
+}
+
+std::vector<MonitorInfo> Win32Backend::QueryMonitors()
+{
+	std::vector<MonitorInfo> monitors;
+	EnumDisplayMonitors(NULL, NULL, MonitorEnumProcCallback, reinterpret_cast<LPARAM>(&monitors));
+	return monitors;
+}
+
+std::vector<std::string> Win32Backend::QueryAdapterDevices()
+{
+	std::vector<std::string> devices;
+	// Ask Direct3D 9 itself, it is what the engine renders with. Loaded dynamically so the
+	// plugin does not pin d3d9.dll or fail to load without it.
+	typedef IDirect3D9*(WINAPI* Direct3DCreate9Proc)(UINT);
+	HMODULE d3d9 = LoadLibraryW(L"d3d9.dll");
+	Direct3DCreate9Proc direct3DCreate9 = d3d9 ? reinterpret_cast<Direct3DCreate9Proc>(GetProcAddress(d3d9, "Direct3DCreate9")) : nullptr;
+	if (IDirect3D9* direct3D = direct3DCreate9 ? direct3DCreate9(D3D_SDK_VERSION) : nullptr)
+	{
+		const UINT count = direct3D->GetAdapterCount();
+		for (UINT adapter = 0; adapter < count; adapter++)
+		{
+			D3DADAPTER_IDENTIFIER9 identifier;
+			devices.push_back(SUCCEEDED(direct3D->GetAdapterIdentifier(adapter, 0, &identifier)) ? identifier.DeviceName : "");
+		}
+		direct3D->Release();
+	}
+	if (d3d9)
+		FreeLibrary(d3d9);
+	if (!devices.empty())
+		return devices;
+
+	// Direct3D 9 numbers the display devices attached to the desktop in this order.
+	DISPLAY_DEVICEW device;
+	device.cb = sizeof(DISPLAY_DEVICEW);
+	for (DWORD i = 0; EnumDisplayDevicesW(NULL, i, &device, 0); i++)
+	{
+		if (device.StateFlags & DISPLAY_DEVICE_ATTACHED_TO_DESKTOP)
+			devices.push_back(ToUTF8(device.DeviceName));
+		device.cb = sizeof(DISPLAY_DEVICEW);
+	}
+	return devices;
+}
+
+WindowRect Win32Backend::GetDesktopRect()
+{
+	RECT rect;
+	GetWindowRect(GetDesktopWindow(), &rect);
+	return FromRECT(rect);
+}
+
+void Win32Backend::SetDisplayChangeCallback(std::function<void()> callback)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		m_displayChange = std::move(callback);
+	}
+	StartEventThread();
+}
+
+void Win32Backend::StartEventThread()
+{
+	std::call_once(m_eventThreadOnce, [this] { std::thread(&Win32Backend::RunEventThread, this).detach(); });
+}
+
+void Win32Backend::NotifyDisplayChange()
+{
+	std::function<void()> callback;
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		callback = m_displayChange;
+	}
+	if (callback)
+		callback();
+}
+
+void Win32Backend::RunEventThread()
+{
+	WNDCLASSW windowClass = {};
+	windowClass.lpfnWndProc = EventWindowProc;
+	windowClass.hInstance = GetModuleHandle(NULL);
+	windowClass.lpszClassName = L"BorderlessWindowedUpdatedEvents";
+	RegisterClassW(&windowClass);
+	// Deliberately not HWND_MESSAGE: message-only windows do not receive broadcasts.
+	HWND hWnd = CreateWindowExW(WS_EX_TOOLWINDOW, windowClass.lpszClassName, L"", WS_POPUP, 0, 0, 0, 0, NULL, NULL, windowClass.hInstance, NULL);
+	if (!hWnd)
+		return;
+	SetWindowLongPtr(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		m_eventWindow = hWnd;
+	}
+	// A backdrop requested before the thread was up.
+	UpdateBackdrop();
+
+	// Out of context hooks are delivered through this thread's message loop, and only for
+	// windows created by this process.
+	g_eventBackend = this;
+	SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_CREATE, NULL, WindowCreatedProc, GetCurrentProcessId(), 0, WINEVENT_OUTOFCONTEXT);
+	// The window may have been created between the caller's lookup and the hook going in.
+	if (WindowHandle window = FindGameWindow())
+		NotifyWindowCreated(window);
+
+	MSG msg;
+	while (GetMessage(&msg, NULL, 0, 0) > 0)
+	{
+		TranslateMessage(&msg);
+		DispatchMessage(&msg);
+	}
+}
+
+void Win32Backend::SetWindowStyle(WindowHandle window, uint32_t style)
+{
+	SetWindowLong(static_cast<HWND>(window), GWL_STYLE, style);
+}
+
+void Win32Backend::SetWindowExStyle(WindowHandle window, uint32_t exStyle)
+{
+	SetWindowLong(static_cast<HWND>(window), GWL_EXSTYLE, exStyle);
+}
+
+WindowRect Win32Backend::AdjustWindowRect(const WindowRect& client, uint32_t style, uint32_t exStyle, unsigned int dpi)
+{
+	static const auto adjustForDpi = reinterpret_cast<AdjustWindowRectExForDpiProc>(GetUser32Proc("AdjustWindowRectExForDpi"));
+	RECT rect = ToRECT(client);
+	if (adjustForDpi)
+		adjustForDpi(&rect, style, FALSE, exStyle, dpi);
+	else
+		AdjustWindowRectEx(&rect, style, FALSE, exStyle);
+	return FromRECT(rect);
+}
+
+void Win32Backend::SetWindowPos(WindowHandle window, WindowZOrder order, int x, int y, int width, int height, bool frameChanged)
+{
+	HWND insertAfter = order == WindowZOrder::NoTopmost ? HWND_NOTOPMOST : HWND_TOP;
+	::SetWindowPos(static_cast<HWND>(window), insertAfter, x, y, width, height, frameChanged ? SWP_FRAMECHANGED : 0);
+}
+
+bool Win32Backend::GetWindowState(WindowHandle window, WindowState& state)
+{
+	HWND hWnd = static_cast<HWND>(window);
+	RECT rect;
+	if (!GetWindowRect(hWnd, &rect))
+		return false;
+	state.style = GetWindowLong(hWnd, GWL_STYLE);
+	state.exStyle = GetWindowLong(hWnd, GWL_EXSTYLE);
+	state.rect = FromRECT(rect);
+	state.minimized = IsIconic(hWnd) != FALSE;
+	QUERY_USER_NOTIFICATION_STATE notification;
+	state.exclusiveFullscreen = SUCCEEDED(SHQueryUserNotificationState(&notification)) && notification == QUNS_RUNNING_D3D_FULL_SCREEN;
+	return true;
+}
+
+void Win32Backend::PostResize(WindowHandle window)
+{
+	HWND hWnd = static_cast<HWND>(window);
+	RECT client;
+	if (!GetClientRect(hWnd, &client))
+		return;
+	const WPARAM type = IsIconic(hWnd) ? SIZE_MINIMIZED : IsZoomed(hWnd) ? SIZE_MAXIMIZED : SIZE_RESTORED;
+	PostMessageW(hWnd, WM_SIZE, type, MAKELPARAM(client.right - client.left, client.bottom - client.top));
+}
+
+void Win32Backend::PostMove(WindowHandle window)
+{
+	HWND hWnd = static_cast<HWND>(window);
+	POINT origin = { 0, 0 };
+	if (!ClientToScreen(hWnd, &origin))
+		return;
+	PostMessageW(hWnd, WM_MOVE, 0, MAKELPARAM(origin.x, origin.y));
+}
+
+void Win32Backend::SetBackdrop(WindowHandle window, const WindowRect* rect)
+{
+	HWND eventWindow;
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		m_backdropAfter = window;
+		m_backdropShown = rect != nullptr;
+		if (rect)
+			m_backdropRect = *rect;
+		eventWindow = static_cast<HWND>(m_eventWindow);
+	}
+	if (eventWindow)
+		PostMessageW(eventWindow, WM_UPDATE_BACKDROP, 0, 0);
+	else
+		StartEventThread();
+}
+
+void Win32Backend::UpdateBackdrop()
+{
+	bool shown;
+	WindowRect rect;
+	HWND after;
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		shown = m_backdropShown;
+		rect = m_backdropRect;
+		after = static_cast<HWND>(m_backdropAfter);
+	}
+	HWND backdrop = static_cast<HWND>(m_backdropWindow);
+	// Created and placed in the game window's coordinate space, whatever the event thread had.
+	if (after && !backdrop)
+		SetThreadDpiAwareness(GetWindowDpiAwareness(after));
+	if (!shown)
+	{
+		if (backdrop)
+			ShowWindow(backdrop, SW_HIDE);
+		return;
+	}
+	if (!backdrop)
+	{
+		WNDCLASSW windowClass = {};
+		windowClass.lpfnWndProc = DefWindowProcW;
+		windowClass.hInstance = GetModuleHandle(NULL);
+		windowClass.hbrBackground = static_cast<HBRUSH>(GetStockObject(BLACK_BRUSH));
+		windowClass.lpszClassName = L"BorderlessWindowedUpdatedBackdrop";
+		RegisterClassW(&windowClass);
+		// Never activated and kept off the taskbar, so focus and alt-tab only ever see the game.
+		backdrop = CreateWindowExW(WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE, windowClass.lpszClassName, L"", WS_POPUP, 0, 0, 0, 0, NULL, NULL,
+			windowClass.hInstance, NULL);
+		if (!backdrop)
+			return;
+		m_backdropWindow = backdrop;
+	}
+	::SetWindowPos(backdrop, after ? after : HWND_BOTTOM, rect.left, rect.top, rect.Width(), rect.Height(), SWP_NOACTIVATE | SWP_SHOWWINDOW);
+}
+
+int Win32Backend::SetThreadDpiAwareness(int awareness)
+{
+	static const DPI_AWARENESS_CONTEXT contexts[] = { DPI_AWARENESS_CONTEXT_UNAWARE, DPI_AWARENESS_CONTEXT_SYSTEM_AWARE,
+		DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE, DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2 };
+	const auto setContext = reinterpret_cast<SetThreadDpiAwarenessContextProc>(GetUser32Proc("SetThreadDpiAwarenessContext"));
+	if (setContext && awareness >= BW_DPI_UNAWARE && awareness <= BW_DPI_PER_MONITOR_AWARE_V2)
+	{
+		// V2 needs Windows 10 1703, the plain per-monitor context is the closest before it.
+		if (!setContext(contexts[awareness]) && awareness == BW_DPI_PER_MONITOR_AWARE_V2)
+			setContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE);
+	}
+	return QueryDpiAwareness();
+}
+
+int Win32Backend::GetWindowDpiAwareness(WindowHandle window)
+{
+	// A window keeps the awareness of the thread that created it, whatever the process declares
+	// later.
+	const auto getContext = reinterpret_cast<GetWindowDpiAwarenessContextProc>(GetUser32Proc("GetWindowDpiAwarenessContext"));
+	if (!getContext)
+		return QueryDpiAwareness();
+	const DPI_AWARENESS_CONTEXT context = getContext(static_cast<HWND>(window));
+	return context ? GetContextAwareness(context) : BW_DPI_UNAWARE;
+}
+
+unsigned int Win32Backend::GetWindowDpi(WindowHandle window)
+{
+	static const auto getDpiForWindow = reinterpret_cast<GetDpiForWindowProc>(GetUser32Proc("GetDpiForWindow"));
+	HWND hWnd = static_cast<HWND>(window);
+	if (getDpiForWindow)
+	{
+		const UINT dpi = getDpiForWindow(hWnd);
+		if (dpi)
+			return dpi;
+	}
+	return GetMonitorDpi(MonitorFromWindow(hWnd, MONITOR_DEFAULTTONEAREST));
+}
+
+uint64_t Win32Backend::GetTime()
+{
+	static const LONGLONG frequency = [] { LARGE_INTEGER value; QueryPerformanceFrequency(&value); return value.QuadPart; }();
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return static_cast<uint64_t>(counter.QuadPart / frequency * 1000000 + counter.QuadPart % frequency * 1000000 / frequency);
+}
+
+void Win32Backend::Sleep(unsigned int milliseconds)
+{
+	::Sleep(milliseconds);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "window_backend.h"
+#include <mutex>
+#include <thread>
+
+class Win32Backend : public WindowBackend
+{
+public:
+	Win32Backend();
+
+	WindowHandle FindGameWindow() override;
+	void SetGameWindowCallback(std::function<void(WindowHandle)> callback) override;
+	bool IsWindowValid(WindowHandle window) override;
+	bool IsForegroundWindow(WindowHandle window) override;
+	bool SetMessageHook(WindowHandle window, std::function<bool(WindowMessage&)> hook) override;
+	std::vector<MonitorInfo> QueryMonitors() override;
+	std::vector<std::string> QueryAdapterDevices() override;
+	WindowRect GetDesktopRect() override;
+	void SetDisplayChangeCallback(std::function<void()> callback) override;
+
+	void SetWindowStyle(WindowHandle window, uint32_t style) override;
+	void SetWindowExStyle(WindowHandle window, uint32_t exStyle) override;
+	WindowRect AdjustWindowRect(const WindowRect& client, uint32_t style, uint32_t exStyle, unsigned int dpi) override;
+	void SetWindowPos(WindowHandle window, WindowZOrder order, int x, int y, int width, int height, bool frameChanged) override;
+	bool GetWindowState(WindowHandle window, WindowState& state) override;
+	void PostResize(WindowHandle window) override;
+	void PostMove(WindowHandle window) override;
+	void SetBackdrop(WindowHandle window, const WindowRect* rect) override;
+
+	int SetThreadDpiAwareness(int awareness) override;
+	int GetWindowDpiAwareness(WindowHandle window) override;
+	unsigned int GetWindowDpi(WindowHandle window) override;
+
+	uint64_t GetTime() override;
+	void Sleep(unsigned int milliseconds) override;
+
+	// Called by the event window when the OS broadcasts a display change.
+	void NotifyDisplayChange();
+	// Called by the event hook when a window of this process is created.
+	void NotifyWindowCreated(WindowHandle window);
+	// Called by the game window procedure. Returns true when the hook swallowed the message.
+	bool RunMessageHook(WindowMessage& message);
+	// Called on the event thread to create, move or hide the backdrop as last requested.
+	void UpdateBackdrop();
+
+private:
+	// Hidden top-level window on its own thread. It receives the display change broadcasts the
+	// game window would, without touching the game's window procedure, and the thread's message
+	// loop also serves the window creation hook.
+	void StartEventThread();
+	void RunEventThread();
+
+	std::mutex m_callbackMutex;
+	std::function<void()> m_displayChange;
+	std::function<void(WindowHandle)> m_gameWindowCreated;
+	std::function<bool(WindowMessage&)> m_messageHook;
+	// The backdrop is owned by the event thread, whose message loop keeps it responsive. Other
+	// threads only leave the request here and wake it.
+	WindowHandle m_eventWindow;
+	WindowHandle m_backdropWindow;
+	WindowHandle m_backdropAfter;
+	bool m_backdropShown;
+	WindowRect m_backdropRect;
+	std::once_flag m_eventThreadOnce;
+};
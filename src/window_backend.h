@@ -0,0 +1,173 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Opaque handles. On Windows these are the HWND/HMONITOR values, the simulated backend hands
+// out its own small integers.
+typedef void* WindowHandle;
+typedef void* MonitorHandle;
+
+struct WindowRect
+{
+	int left;
+	int top;
+	int right;
+	int bottom;
+
+	int Width() const { return right - left; }
+	int Height() const { return bottom - top; }
+	bool operator==(const WindowRect& other) const
+	{
+		return left == other.left && top == other.top && right == other.right && bottom == other.bottom;
+	}
+	bool operator!=(const WindowRect& other) const { return !(*this == other); }
+};
+
+// Win32 style bits used by the core. The values match <windows.h> so the Win32 backend can pass
+// them straight through, while the core and the simulated backend build without it.
+#define BW_WS_POPUP 0x80000000u
+#define BW_WS_VISIBLE 0x10000000u
+#define BW_WS_CLIPSIBLINGS 0x04000000u
+#define BW_WS_CLIPCHILDREN 0x02000000u
+#define BW_WS_CAPTION 0x00C00000u
+#define BW_WS_SYSMENU 0x00080000u
+#define BW_WS_MINIMIZEBOX 0x00020000u
+#define BW_WS_THICKFRAME 0x00040000u
+#define BW_WS_EX_DLGMODALFRAME 0x00000001u
+#define BW_WS_EX_TRANSPARENT 0x00000020u
+#define BW_WS_EX_STATICEDGE 0x00020000u
+#define BW_WS_EX_LAYERED 0x00080000u
+#define BW_WS_EX_WINDOWEDGE 0x00000100u
+#define BW_WS_EX_CLIENTEDGE 0x00000200u
+#define BW_WS_EX_OVERLAPPEDWINDOW (BW_WS_EX_WINDOWEDGE | BW_WS_EX_CLIENTEDGE)
+
+#define BW_DEFAULT_DPI 96
+
+// How a thread or window sees DPI. Below per-monitor awareness the system virtualises
+// coordinates on scaled monitors and DWM stretches the output.
+enum DpiAwareness
+{
+	BW_DPI_UNAWARE = 0,
+	BW_DPI_SYSTEM_AWARE,
+	BW_DPI_PER_MONITOR_AWARE,
+	BW_DPI_PER_MONITOR_AWARE_V2
+};
+
+struct MonitorInfo
+{
+	MonitorHandle handle;
+	WindowRect rect;
+	WindowRect workArea;
+	int refreshRate;
+	unsigned int dpi;
+	bool primary;
+	// GDI device name, such as \\.\DISPLAY1.
+	std::string deviceName;
+};
+
+// Snapshot of what the engine has done to the window, polled while waiting for it to settle.
+struct WindowState
+{
+	uint32_t style;
+	uint32_t exStyle;
+	WindowRect rect;
+	bool minimized;
+	// A Direct3D application currently owns the display exclusively.
+	bool exclusiveFullscreen;
+
+	bool operator==(const WindowState& other) const
+	{
+		return style == other.style && exStyle == other.exStyle && rect == other.rect
+			&& minimized == other.minimized && exclusiveFullscreen == other.exclusiveFullscreen;
+	}
+	bool operator!=(const WindowState& other) const { return !(*this == other); }
+};
+
+// The game window messages the core looks at, translated from their Win32 form.
+enum WindowMessageType
+{
+	// WM_ACTIVATEAPP, `active` set when the game is being activated.
+	WINDOW_MESSAGE_ACTIVATE_APP,
+	// WM_SIZE, `minimized` set for SIZE_MINIMIZED and `rect` holding the new client size.
+	WINDOW_MESSAGE_SIZE,
+	// WM_WINDOWPOSCHANGED, `rect` holding the new window rect. Default handling turns it into
+	// WM_SIZE and WM_MOVE.
+	WINDOW_MESSAGE_WINDOW_POS_CHANGED,
+	// WM_SYSCOMMAND with SC_MINIMIZE.
+	WINDOW_MESSAGE_MINIMIZE_COMMAND,
+	// WM_MOVE, `rect` holding the new client origin in screen coordinates in `left` and `top`.
+	WINDOW_MESSAGE_MOVE
+};
+
+struct WindowMessage
+{
+	WindowMessageType type;
+	bool active;
+	bool minimized;
+	WindowRect rect;
+};
+
+enum class WindowZOrder
+{
+	Top,
+	NoTopmost
+};
+
+// Everything the core needs from the window system. The plugin uses the Win32 implementation,
+// the Linux build uses the simulated one to test and benchmark the transition logic.
+class WindowBackend
+{
+public:
+	virtual ~WindowBackend() = default;
+
+	// The game's top-level window in this process, or null while it does not exist yet.
+	virtual WindowHandle FindGameWindow() = 0;
+	// The callback runs on a backend thread when a game window is created in this process. Only
+	// one callback is kept.
+	virtual void SetGameWindowCallback(std::function<void(WindowHandle)> callback) = 0;
+	// Cheap check that the handle still names a live window of this process.
+	virtual bool IsWindowValid(WindowHandle window) = 0;
+	// The window is the one the user is working in.
+	virtual bool IsForegroundWindow(WindowHandle window) = 0;
+	// Sees the window's messages before the game does, on the thread that owns the window. When
+	// the hook returns true the message is swallowed and the game never receives it; otherwise
+	// the game receives it as the hook left it, so a WM_SIZE can be rewritten. Only one window is
+	// hooked at a time; setting a new hook moves it.
+	virtual bool SetMessageHook(WindowHandle window, std::function<bool(WindowMessage&)> hook) = 0;
+	virtual std::vector<MonitorInfo> QueryMonitors() = 0;
+	// GDI device name of each Direct3D adapter, indexed by adapter ordinal.
+	virtual std::vector<std::string> QueryAdapterDevices() = 0;
+	virtual WindowRect GetDesktopRect() = 0;
+	// The callback runs on a backend thread whenever monitors are added, removed, rearranged or
+	// change mode. Only one callback is kept.
+	virtual void SetDisplayChangeCallback(std::function<void()> callback) = 0;
+
+	virtual void SetWindowStyle(WindowHandle window, uint32_t style) = 0;
+	virtual void SetWindowExStyle(WindowHandle window, uint32_t exStyle) = 0;
+	// Frame metrics at the given DPI, like AdjustWindowRectExForDpi.
+	virtual WindowRect AdjustWindowRect(const WindowRect& client, uint32_t style, uint32_t exStyle, unsigned int dpi) = 0;
+	virtual void SetWindowPos(WindowHandle window, WindowZOrder order, int x, int y, int width, int height, bool frameChanged) = 0;
+	virtual bool GetWindowState(WindowHandle window, WindowState& state) = 0;
+	// Posts the window a WM_SIZE for its current client size, through the message hook.
+	virtual void PostResize(WindowHandle window) = 0;
+	// Posts the window a WM_MOVE for its current client origin, through the message hook.
+	virtual void PostMove(WindowHandle window) = 0;
+	// Shows a black window covering `rect` right behind the game window, so the part of the
+	// monitor the game does not cover stays black. Null hides it.
+	virtual void SetBackdrop(WindowHandle window, const WindowRect* rect) = 0;
+
+	// Sets the calling thread's DPI awareness, never the process's. Windows the thread creates
+	// afterwards get it, and the thread's window and monitor calls use its coordinate space.
+	// Returns the awareness in effect, which stays lower without Windows 10 1607.
+	virtual int SetThreadDpiAwareness(int awareness) = 0;
+	// The awareness the window was created with. A window never changes it.
+	virtual int GetWindowDpiAwareness(WindowHandle window) = 0;
+	// The DPI the window is scaled for, BW_DEFAULT_DPI when unaware.
+	virtual unsigned int GetWindowDpi(WindowHandle window) = 0;
+
+	// Monotonic time in microseconds.
+	virtual uint64_t GetTime() = 0;
+	virtual void Sleep(unsigned int milliseconds) = 0;
+};
@@ -0,0 +1,500 @@
+#include "test.h"
+#include "display_mode.h"
+#include "simulated_backend.h"
+#include <thread>
+
+static WindowHandle SetupSingleMonitor(SimulatedBackend& backend)
+{
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	return backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+}
+
+TEST(WindowedCentersOnMonitor)
+{
+	SimulatedBackend backend;
+	WindowHandle window = SetupSingleMonitor(backend);
+	DisplayModeController controller(backend);
+	CHECK(controller.Attach());
+	controller.RefreshMonitors();
+
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_WINDOWED, 1280, 720, 0));
+
+	SimulatedBackend::Window state = backend.GetWindow(window);
+	CHECK_EQ(state.style, (uint32_t)PAYDAY2_WINDOWED_STYLE);
+	CHECK_EQ(state.exStyle, (uint32_t)PAYDAY2_WINDOWED_EX_STYLE);
+	const WindowRect frame = backend.AdjustWindowRect({ 0, 0, 1280, 720 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE, BW_DEFAULT_DPI);
+	CHECK_EQ(state.rect.Width(), frame.Width());
+	CHECK_EQ(state.rect.Height(), frame.Height());
+	CHECK_EQ(state.rect.left, (1920 - frame.Width()) / 2);
+	CHECK_EQ(state.rect.top, (1080 - frame.Height()) / 2);
+}
+
+TEST(FullscreenWindowedCoversMonitor)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	backend.AddMonitor({ 1920, 0, 4480, 1440 });
+	WindowHandle window = backend.CreateGameWindow({ 100, 100, 900, 700 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	controller.ChangeDisplayMode(DISPLAY_MODE_FULLSCREEN_WINDOWED, 1280, 720, 1);
+
+	SimulatedBackend::Window state = backend.GetWindow(window);
+	CHECK_EQ(state.style, (uint32_t)PAYDAY2_FULLSCREEN_WINDOWED_STYLE);
+	CHECK_EQ(state.exStyle, 0u);
+	CHECK(state.rect == (WindowRect{ 1920, 0, 4480, 1440 }));
+}
+
+TEST(UnknownAdapterFallsBackToDesktop)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	backend.AddMonitor({ 1920, 0, 3840, 1080 });
+	backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP, 0);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	CHECK(controller.GetMonitorRect(5) == (WindowRect{ 0, 0, 3840, 1080 }));
+	CHECK(controller.GetMonitorRect(-1) == (WindowRect{ 0, 0, 3840, 1080 }));
+}
+
+TEST(FullscreenModeIsLeftToTheEngine)
+{
+	SimulatedBackend backend;
+	SetupSingleMonitor(backend);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_FULLSCREEN, 1920, 1080, 0));
+	CHECK_EQ(backend.GetCalls().Total(), 0);
+	CHECK(!controller.ChangeDisplayMode(3, 1920, 1080, 0));
+}
+
+TEST(SetWindowPosPostsMessages)
+{
+	SimulatedBackend backend;
+	WindowHandle window = SetupSingleMonitor(backend);
+	backend.SetPosCost(500);
+
+	backend.SetWindowPos(window, WindowZOrder::Top, 0, 0, 1920, 1080, true);
+	backend.SetWindowPos(window, WindowZOrder::Top, 0, 0, 1920, 1080, false);
+
+	CHECK_EQ(backend.GetMessages().size(), 3u);
+	CHECK_EQ(backend.GetCalls().frameChanged, 1);
+	CHECK_EQ(backend.GetTime(), 1000u);
+}
+
+TEST(FullscreenWindowedWaitsForEngineReset)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	SimulatedBackend::Window exclusive = backend.GetWindow(window);
+	exclusive.exclusiveFullscreen = true;
+	backend.ScheduleWindowState(window, 0, exclusive);
+	// The engine leaves exclusive mode 40 ms in and restyles the window as windowed.
+	backend.ScheduleWindowState(window, 40000, { PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE, { 0, 0, 1280, 720 }, false, false, false });
+	backend.AdvanceTime(0);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	controller.FullscreenWindowed(0);
+
+	ReadinessReport report = controller.GetReadinessReport();
+	CHECK(!report.lastTimedOut);
+	CHECK(report.lastWaitUs >= 40000 + 16000);
+	CHECK(report.lastWaitUs < 100000);
+	CHECK_EQ(backend.GetWindow(window).style, (uint32_t)PAYDAY2_FULLSCREEN_WINDOWED_STYLE);
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ 0, 0, 1920, 1080 }));
+}
+
+TEST(FullscreenWindowedSkipsWaitWhenAlreadySettled)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	backend.CreateGameWindow({ 100, 100, 1380, 820 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	// Usable on the first look, so not even the settle time is spent.
+	controller.FullscreenWindowed(0);
+
+	CHECK_EQ(controller.GetReadinessReport().lastWaitUs, 0u);
+	CHECK_EQ(backend.GetTime(), 0u);
+}
+
+TEST(ReadinessTimeoutFallback)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	SimulatedBackend::Window exclusive = backend.GetWindow(window);
+	exclusive.exclusiveFullscreen = true;
+	backend.ScheduleWindowState(window, 0, exclusive);
+	backend.AdvanceTime(0);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	controller.SetReadinessOptions({ 50, 16, 2, false });
+	controller.FullscreenWindowed(0);
+	CHECK(controller.GetReadinessReport().lastTimedOut);
+	CHECK_EQ(backend.GetCalls().setStyle, 0);
+
+	controller.SetReadinessOptions({ 50, 16, 2, true });
+	controller.FullscreenWindowed(0);
+	ReadinessReport report = controller.GetReadinessReport();
+	CHECK_EQ(report.timeouts, 2u);
+	CHECK_EQ(report.lastWaitUs, 50000u);
+	CHECK_EQ(backend.GetCalls().setStyle, 1);
+}
+
+TEST(ReapplyingTheSameModeIsSkipped)
+{
+	SimulatedBackend backend;
+	WindowHandle window = SetupSingleMonitor(backend);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	controller.Windowed(1280, 720, 0);
+	backend.ResetCounters();
+	controller.Windowed(1280, 720, 0);
+	CHECK_EQ(backend.GetCalls().setStyle + backend.GetCalls().setExStyle + backend.GetCalls().setPos, 0);
+
+	controller.FullscreenWindowed(0);
+	backend.ResetCounters();
+	controller.FullscreenWindowed(0);
+	CHECK_EQ(backend.GetCalls().setStyle + backend.GetCalls().setExStyle + backend.GetCalls().setPos, 0);
+	CHECK(backend.GetMessages().empty());
+
+	ReconcileCounters counters = controller.GetReconcileCounters();
+	CHECK_EQ(counters.styleApplied, 2u);
+	CHECK_EQ(counters.styleSkipped, 2u);
+	CHECK_EQ(counters.posSkipped, 2u);
+	CHECK_EQ(counters.frameChanges, 2u);
+
+	WindowState applied;
+	CHECK(controller.GetLastApplied(applied));
+	CHECK_EQ(applied.style, (uint32_t)PAYDAY2_FULLSCREEN_WINDOWED_STYLE);
+	CHECK(applied.rect == backend.GetWindow(window).rect);
+}
+
+TEST(ResizeWithoutRestyleSkipsFrameChange)
+{
+	SimulatedBackend backend;
+	SetupSingleMonitor(backend);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	controller.Windowed(1280, 720, 0);
+	backend.ResetCounters();
+	controller.Windowed(1600, 900, 0);
+
+	SimulatedBackend::Calls calls = backend.GetCalls();
+	CHECK_EQ(calls.setStyle, 0);
+	CHECK_EQ(calls.setExStyle, 0);
+	CHECK_EQ(calls.setPos, 1);
+	CHECK_EQ(calls.frameChanged, 0);
+}
+
+TEST(StyleChangedByTheEngineIsReapplied)
+{
+	SimulatedBackend backend;
+	WindowHandle window = SetupSingleMonitor(backend);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	controller.FullscreenWindowed(0);
+	backend.SetWindowStyle(window, PAYDAY2_WINDOWED_STYLE);
+	backend.ResetCounters();
+	controller.FullscreenWindowed(0);
+
+	SimulatedBackend::Calls calls = backend.GetCalls();
+	CHECK_EQ(calls.setStyle, 1);
+	CHECK_EQ(calls.setExStyle, 0);
+	CHECK_EQ(calls.frameChanged, 1);
+	CHECK_EQ(backend.GetWindow(window).style, (uint32_t)PAYDAY2_FULLSCREEN_WINDOWED_STYLE);
+}
+
+TEST(DisplayConfigAppliesPositionInOneSetWindowPos)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	backend.AddMonitor({ 1920, 0, 4480, 1440 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	backend.ResetCounters();
+
+	CHECK(controller.ApplyDisplayConfig({ DISPLAY_MODE_WINDOWED, 1280, 720, 1, true, 100, 50 }));
+
+	const WindowRect frame = backend.AdjustWindowRect({ 0, 0, 1280, 720 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE, BW_DEFAULT_DPI);
+	const SimulatedBackend::Window state = backend.GetWindow(window);
+	CHECK(state.rect == (WindowRect{ 2020, 50, 2020 + frame.Width(), 50 + frame.Height() }));
+	CHECK_EQ(backend.GetCalls().setPos, 1);
+	CHECK_EQ(controller.GetMode(), DISPLAY_MODE_WINDOWED);
+}
+
+TEST(ControllerAttachesToLateWindowAndRevalidates)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	DisplayModeController controller(backend);
+	controller.RefreshMonitors();
+	int attached = 0;
+	controller.WatchWindow([&attached] { attached++; });
+	CHECK(controller.GetWindow() == nullptr);
+	CHECK(!controller.ChangeDisplayMode(DISPLAY_MODE_FULLSCREEN_WINDOWED, 0, 0, 0));
+	CHECK_EQ(controller.GetLastError(), std::string("no game window"));
+
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1280, 720 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE);
+	CHECK_EQ(attached, 1);
+	CHECK(controller.GetWindow() == window);
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_FULLSCREEN_WINDOWED, 0, 0, 0));
+	// Reporting the window the controller already has is not a new attach.
+	backend.ReportGameWindow(window);
+	CHECK_EQ(attached, 1);
+
+	// A stale handle is replaced before the next transition touches it.
+	backend.DestroyWindow(window);
+	backend.SetGameWindowCallback(nullptr);
+	WindowHandle replacement = backend.CreateGameWindow({ 0, 0, 1280, 720 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE);
+	CHECK(controller.GetWindow() == window);
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_WINDOWED, 1280, 720, 0));
+	CHECK(controller.GetWindow() == replacement);
+}
+
+TEST(TransitionDeliversOneResize)
+{
+	SimulatedBackend backend;
+	WindowHandle window = SetupSingleMonitor(backend);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	CHECK(backend.SetMessageHook(window, [&controller](WindowMessage& message) { return controller.FilterMessage(message); }));
+
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_WINDOWED, 1280, 720, 0));
+
+	int sizes = 0;
+	for (const SimulatedBackend::Message& message : backend.GetMessages())
+	{
+		CHECK(message.name != "WM_WINDOWPOSCHANGED");
+		if (message.name == "WM_SIZE")
+			sizes++;
+	}
+	CHECK_EQ(sizes, 1);
+	// Swallowing WM_WINDOWPOSCHANGED also keeps default handling from sending its WM_SIZE.
+	ResizeCounters counters = controller.GetResizeCounters();
+	CHECK_EQ(counters.held, 1u);
+	CHECK_EQ(counters.lastTransitionDelivered, 1u);
+	CHECK_EQ(counters.transitions, 1u);
+
+	// Resizes outside a transition reach the engine untouched.
+	backend.SetWindowPos(window, WindowZOrder::Top, 0, 0, 800, 600, false);
+	CHECK_EQ(controller.GetResizeCounters().delivered, 2u);
+}
+
+TEST(TransitionDeliversFinalPosition)
+{
+	SimulatedBackend backend;
+	WindowHandle window = SetupSingleMonitor(backend);
+	backend.AddMonitor({ 1920, 0, 3840, 1080 });
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	CHECK(backend.SetMessageHook(window, [&controller](WindowMessage& message) { return controller.FilterMessage(message); }));
+
+	// Moving to the other monitor reports where the client area ended up, before the resize.
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_FULLSCREEN_WINDOWED, 0, 0, 1));
+	const std::vector<SimulatedBackend::Message> messages = backend.GetMessages();
+	int moves = 0;
+	size_t move = 0;
+	size_t size = 0;
+	for (size_t i = 0; i < messages.size(); i++)
+	{
+		if (messages[i].name == "WM_MOVE")
+		{
+			moves++;
+			move = i;
+		}
+		else if (messages[i].name == "WM_SIZE")
+		{
+			size = i;
+		}
+	}
+	CHECK_EQ(moves, 1);
+	CHECK(move < size);
+	CHECK_EQ(messages[move].rect.left, 1920);
+	CHECK_EQ(messages[move].rect.top, 0);
+}
+
+TEST(FlipEligibilityReportsBlockers)
+{
+	MonitorTopologySnapshot topology = {};
+	topology.monitors.push_back(MonitorInfo{ nullptr, { 0, 0, 1920, 1080 }, { 0, 0, 1920, 1040 }, 60, 96, true, "\\\\.\\DISPLAY1" });
+	topology.monitors.push_back(MonitorInfo{ nullptr, { 1920, 0, 3840, 1080 }, { 1920, 0, 3840, 1080 }, 60, 96, false, "\\\\.\\DISPLAY2" });
+	topology.desktop = { 0, 0, 3840, 1080 };
+
+	WindowState state = { PAYDAY2_FULLSCREEN_WINDOWED_STYLE, 0, { 1920, 0, 3840, 1080 }, false, false };
+	CHECK_EQ(CheckFlipEligibility(state, topology), 0u);
+
+	state.rect = topology.desktop;
+	state.exStyle = BW_WS_EX_LAYERED;
+	CHECK_EQ(CheckFlipEligibility(state, topology), (uint32_t)(FLIP_BLOCKER_MONITOR_RECT | FLIP_BLOCKER_EX_STYLE));
+
+	state = { PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE, { 0, 0, 1920, 1080 }, true, false };
+	CHECK_EQ(CheckFlipEligibility(state, topology), (uint32_t)(FLIP_BLOCKER_STYLE | FLIP_BLOCKER_EX_STYLE | FLIP_BLOCKER_MINIMIZED));
+}
+
+TEST(FlipEnforcementAvoidsDesktopRect)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	backend.AddMonitor({ 1920, 0, 3840, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 100, 100, 900, 700 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	// Unknown adapter: without enforcement the window spans both monitors.
+	CHECK(controller.FullscreenWindowed(5));
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ 0, 0, 3840, 1080 }));
+	CHECK_EQ(controller.CheckFlip().blockers, (uint32_t)FLIP_BLOCKER_MONITOR_RECT);
+
+	controller.SetFlipEnforced(true);
+	CHECK(controller.FullscreenWindowed(5));
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ 0, 0, 1920, 1080 }));
+	FlipReport report = controller.GetFlipReport();
+	CHECK_EQ(report.blockers, 0u);
+	CHECK(report.monitor == (WindowRect{ 0, 0, 1920, 1080 }));
+	CHECK_EQ(report.checks, 2u);
+	CHECK_EQ(report.failures, 1u);
+}
+
+TEST(PresentRectScaling)
+{
+	const WindowRect monitor = { 1920, 0, 4480, 1440 };
+	CHECK(ComputePresentRect(1280, 720, monitor, PRESENT_SCALING_STRETCH) == monitor);
+	CHECK(ComputePresentRect(1280, 720, monitor, PRESENT_SCALING_ASPECT) == (WindowRect{ 1920, 0, 4480, 1440 }));
+	CHECK(ComputePresentRect(1024, 768, monitor, PRESENT_SCALING_ASPECT) == (WindowRect{ 2240, 0, 4160, 1440 }));
+	CHECK(ComputePresentRect(1000, 600, monitor, PRESENT_SCALING_INTEGER) == (WindowRect{ 2200, 120, 4200, 1320 }));
+	// Larger than the monitor: integer falls back to aspect.
+	CHECK(ComputePresentRect(3840, 2160, monitor, PRESENT_SCALING_INTEGER) == (WindowRect{ 1920, 0, 4480, 1440 }));
+}
+
+TEST(ScaledFullscreenWindowedRendersAtConfiguredSize)
+{
+	SimulatedBackend backend;
+	WindowHandle window = SetupSingleMonitor(backend);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	CHECK(backend.SetMessageHook(window, [&controller](WindowMessage& message) { return controller.FilterMessage(message); }));
+	controller.Windowed(800, 600, 0);
+	backend.ResetCounters();
+
+	CHECK(controller.ApplyDisplayConfig({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1024, 768, 0, false, 0, 0, PRESENT_SCALING_ASPECT }));
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ 240, 0, 1680, 1080 }));
+	WindowRect backdrop;
+	CHECK(backend.GetBackdrop(backdrop));
+	CHECK(backdrop == (WindowRect{ 0, 0, 1920, 1080 }));
+	const std::vector<SimulatedBackend::Message> messages = backend.GetMessages();
+	CHECK(messages.back().name == "WM_SIZE");
+	CHECK(messages.back().rect == (WindowRect{ 0, 0, 1024, 768 }));
+
+	// Stretch covers the monitor and keeps the render size, so only a resize is posted.
+	backend.ResetCounters();
+	CHECK(controller.ApplyDisplayConfig({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1280, 720, 0, false, 0, 0, PRESENT_SCALING_STRETCH }));
+	CHECK(!backend.GetBackdrop(backdrop));
+	CHECK_EQ(controller.CheckFlip().blockers, 0u);
+	backend.ResetCounters();
+	CHECK(controller.ApplyDisplayConfig({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1600, 900, 0, false, 0, 0, PRESENT_SCALING_STRETCH }));
+	CHECK_EQ(backend.GetCalls().setPos, 0);
+	CHECK(backend.GetMessages().back().rect == (WindowRect{ 0, 0, 1600, 900 }));
+
+	// Windowed reports the real size again.
+	CHECK(controller.Windowed(800, 600, 0));
+	CHECK(controller.GetPresentState().renderWidth == 0);
+	CHECK(backend.GetMessages().back().rect == (WindowRect{ 0, 0, 800, 600 }));
+}
+
+TEST(FlipEnforcementStretchesScaledPresent)
+{
+	SimulatedBackend backend;
+	WindowHandle window = SetupSingleMonitor(backend);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	controller.SetFlipEnforced(true);
+
+	// The backdrop aspect scaling needs would block independent flip, so it is stretched.
+	CHECK(controller.ApplyDisplayConfig({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1024, 768, 0, false, 0, 0, PRESENT_SCALING_ASPECT }));
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ 0, 0, 1920, 1080 }));
+	WindowRect backdrop;
+	CHECK(!backend.GetBackdrop(backdrop));
+	CHECK_EQ(controller.GetPresentState().renderWidth, 1024);
+	FlipReport report = controller.GetFlipReport();
+	CHECK_EQ(report.blockers, 0u);
+	CHECK(report.scalingStretched);
+
+	CHECK(controller.ApplyDisplayConfig({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1024, 768, 0, false, 0, 0, PRESENT_SCALING_STRETCH }));
+	CHECK(!controller.GetFlipReport().scalingStretched);
+}
+
+TEST(WindowedFrameFollowsMonitorDpi)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	backend.AddMonitorInfo(MonitorInfo{ nullptr, { 1920, 0, 5760, 2160 }, { 1920, 0, 5760, 2100 }, 60, 144, false, std::string() });
+	WindowHandle early = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	// An unaware window keeps the system metrics everywhere, and the thread placing it adopts
+	// its awareness rather than mixing coordinate spaces with it.
+	CHECK_EQ(backend.GetWindowDpiAwareness(early), (int)BW_DPI_UNAWARE);
+	CHECK_EQ(controller.GetDpiAwareness(), (int)BW_DPI_UNAWARE);
+	CHECK_EQ(backend.GetThreadDpiAwareness(), (int)BW_DPI_UNAWARE);
+	CHECK(controller.Windowed(1280, 720, 1));
+	const WindowRect unaware = backend.GetWindow(early).rect;
+	CHECK_EQ(backend.GetWindowDpi(early), (unsigned int)BW_DEFAULT_DPI);
+	const WindowRect systemFrame = backend.AdjustWindowRect({ 0, 0, 1280, 720 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE, BW_DEFAULT_DPI);
+	CHECK_EQ(unaware.Height(), systemFrame.Height());
+
+	// Before the engine creates its window the thread becomes aware, so the window is as well.
+	backend.DestroyWindow(early);
+	CHECK(!controller.Attach());
+	CHECK_EQ(controller.MatchDpiAwareness(), (int)BW_DPI_PER_MONITOR_AWARE_V2);
+	CHECK_EQ(controller.GetAdapterDpi(1), 144u);
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	CHECK_EQ(backend.GetWindowDpiAwareness(window), (int)BW_DPI_PER_MONITOR_AWARE_V2);
+
+	// A transition on another thread places it in the window's coordinate space too.
+	bool applied = false;
+	int threadAwareness = BW_DPI_UNAWARE;
+	std::thread worker([&] {
+		applied = controller.Windowed(1280, 720, 1);
+		threadAwareness = backend.GetThreadDpiAwareness();
+	});
+	worker.join();
+	CHECK(applied);
+	CHECK_EQ(threadAwareness, (int)BW_DPI_PER_MONITOR_AWARE_V2);
+	CHECK(controller.GetWindow() == window);
+	const WindowRect aware = backend.GetWindow(window).rect;
+	CHECK_EQ(backend.GetWindowDpi(window), 144u);
+	const WindowRect frame = backend.AdjustWindowRect({ 0, 0, 1280, 720 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE, 144);
+	CHECK_EQ(aware.Width(), frame.Width());
+	CHECK_EQ(aware.Height(), frame.Height());
+	CHECK(aware.Height() > unaware.Height());
+}
@@ -0,0 +1,98 @@
+#include "test.h"
+#include "focus_filter.h"
+#include "simulated_backend.h"
+
+static WindowMessage ActivateApp(bool active)
+{
+	WindowMessage message = {};
+	message.type = WINDOW_MESSAGE_ACTIVATE_APP;
+	message.active = active;
+	return message;
+}
+
+static WindowMessage Minimize()
+{
+	WindowMessage message = {};
+	message.type = WINDOW_MESSAGE_MINIMIZE_COMMAND;
+	return message;
+}
+
+TEST(FocusFilterKeepsAltTabFromFullscreenWindowedGame)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	DisplayModeController controller(backend);
+	CHECK(controller.Attach());
+	controller.RefreshMonitors();
+	FocusFilter filter(controller);
+	CHECK(backend.SetMessageHook(window, [&filter](const WindowMessage& message) { return filter.OnMessage(message); }));
+
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_FULLSCREEN_WINDOWED, 0, 0, 0));
+	CHECK(!backend.DeliverMessage(window, ActivateApp(false)));
+	CHECK(!backend.DeliverMessage(window, Minimize()));
+	backend.AdvanceTime(5000000);
+	CHECK(!backend.DeliverMessage(window, ActivateApp(true)));
+	backend.AdvanceTime(16000);
+	filter.OnFrame(backend.GetTime());
+	// Only the first frame after activation counts.
+	filter.OnFrame(backend.GetTime() + 16000);
+
+	AltTabStats stats = filter.GetStats();
+	CHECK_EQ(stats.suppressed, 3u);
+	CHECK_EQ(stats.filtered.count, 1u);
+	CHECK_EQ(stats.filtered.lastUs, 16000u);
+	CHECK_EQ(stats.unfiltered.count, 0u);
+}
+
+TEST(FocusFilterPassesMessagesOutsideFullscreenWindowed)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	DisplayModeController controller(backend);
+	CHECK(controller.Attach());
+	controller.RefreshMonitors();
+	FocusFilter filter(controller);
+	CHECK(backend.SetMessageHook(window, [&filter](const WindowMessage& message) { return filter.OnMessage(message); }));
+
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_WINDOWED, 1280, 720, 0));
+	CHECK(backend.DeliverMessage(window, ActivateApp(false)));
+	CHECK(backend.DeliverMessage(window, Minimize()));
+	CHECK(backend.DeliverMessage(window, ActivateApp(true)));
+	backend.AdvanceTime(400000);
+	filter.OnFrame(backend.GetTime());
+
+	// Disabled, fullscreen windowed behaves the same.
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_FULLSCREEN_WINDOWED, 0, 0, 0));
+	filter.SetEnabled(false);
+	CHECK(backend.DeliverMessage(window, ActivateApp(false)));
+	CHECK(backend.DeliverMessage(window, ActivateApp(true)));
+
+	AltTabStats stats = filter.GetStats();
+	CHECK_EQ(stats.suppressed, 0u);
+	CHECK_EQ(stats.unfiltered.count, 1u);
+	CHECK_EQ(stats.unfiltered.lastUs, 400000u);
+	CHECK_EQ(stats.filtered.count, 0u);
+}
+
+TEST(FocusFilterPassesMovesWhileDeactivated)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	DisplayModeController controller(backend);
+	CHECK(controller.Attach());
+	controller.RefreshMonitors();
+	FocusFilter filter(controller);
+	CHECK(backend.SetMessageHook(window, [&filter](const WindowMessage& message) { return filter.OnMessage(message); }));
+
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_FULLSCREEN_WINDOWED, 0, 0, 0));
+	CHECK(!backend.DeliverMessage(window, ActivateApp(false)));
+	WindowMessage move = {};
+	move.type = WINDOW_MESSAGE_MOVE;
+	move.rect = { 1920, 0, 1920, 0 };
+	CHECK(backend.DeliverMessage(window, move));
+	CHECK(backend.GetMessages().back().name == "WM_MOVE");
+	CHECK_EQ(filter.GetStats().suppressed, 1u);
+}
@@ -0,0 +1,51 @@
+#include "test.h"
+#include "frame_benchmark.h"
+
+TEST(FrameBenchmarkCyclesModesAndRestoresOriginal)
+{
+	FrameBenchmark benchmark;
+	CHECK(benchmark.Start({ { 0, 1, 2 }, 10, 100 }, 1));
+	CHECK(!benchmark.Start({ { 0 }, 10, 100 }, 1));
+
+	// Mode 2 runs at a steady 10 ms, the other two at 16 ms with one long frame each.
+	std::vector<int> switches;
+	int mode = -1;
+	uint64_t now = 0;
+	while (benchmark.IsRunning())
+	{
+		const bool slow = mode != 2 && now % 160000 == 0;
+		now += mode == 2 ? 10000 : slow ? 50000 : 16000;
+		const int next = benchmark.Tick(now);
+		if (next >= 0)
+		{
+			switches.push_back(next);
+			mode = next;
+		}
+	}
+
+	CHECK(benchmark.IsFinished());
+	CHECK_EQ(switches.size(), 4u);
+	CHECK_EQ(switches[0], 0);
+	CHECK_EQ(switches[2], 2);
+	CHECK_EQ(switches[3], 1);
+	const std::vector<FrameBenchmarkResult>& results = benchmark.GetResults();
+	CHECK_EQ(results.size(), 3u);
+	CHECK_EQ(results[2].stats.frames, 10u);
+	CHECK_EQ(results[2].stats.p99Us, 10000u);
+	CHECK_EQ(benchmark.GetBestMode(), 2);
+	CHECK(benchmark.FormatReport().find("best mode by p99: 2") != std::string::npos);
+}
+
+TEST(FrameBenchmarkSettlesBeforeCapturing)
+{
+	FrameBenchmark benchmark;
+	CHECK(benchmark.Start({ { 2 }, 5, 1000 }, 2));
+	CHECK_EQ(benchmark.Tick(0), 2);
+	// A slow frame during the settle period is never captured.
+	CHECK_EQ(benchmark.Tick(900000), -1);
+	CHECK_EQ(benchmark.Tick(1000000), -1);
+	for (int i = 1; i <= 5; i++)
+		CHECK_EQ(benchmark.Tick(1000000 + i * 16000), -1);
+	CHECK(benchmark.IsFinished());
+	CHECK_EQ(benchmark.GetResults()[0].stats.maxUs, 16000u);
+}
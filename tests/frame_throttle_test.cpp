@@ -0,0 +1,77 @@
+#include "test.h"
+#include "frame_throttle.h"
+#include "simulated_backend.h"
+
+TEST(FrameThrottleCapsBackgroundFrames)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	FrameThrottle throttle(backend);
+	throttle.SetCap(20);
+
+	// In the foreground nothing waits.
+	throttle.OnFrame(window);
+	backend.AdvanceTime(5000);
+	throttle.OnFrame(window);
+	CHECK_EQ(backend.GetTime(), 5000u);
+	CHECK_EQ(throttle.GetStats().throttledFrames, 0u);
+
+	// In the background each frame is stretched to 50 ms, in sleeps of at most kPollMs.
+	backend.SetForeground(nullptr);
+	backend.ResetCounters();
+	for (int i = 0; i < 4; i++)
+	{
+		backend.AdvanceTime(5000);
+		throttle.OnFrame(window);
+	}
+	CHECK_EQ(backend.GetTime(), 5000u + 4 * 50000u);
+	CHECK(backend.GetCalls().sleep >= 4 * 5);
+	FrameThrottleStats stats = throttle.GetStats();
+	CHECK_EQ(stats.throttledFrames, 4u);
+	CHECK_EQ(stats.throttledUs, 4 * 45000u);
+	CHECK(stats.active);
+
+	// Back in the foreground the next frame runs at once.
+	backend.SetForeground(window);
+	backend.AdvanceTime(5000);
+	throttle.OnFrame(window);
+	CHECK_EQ(backend.GetTime(), 5000u + 4 * 50000u + 5000u);
+	CHECK(!throttle.GetStats().active);
+}
+
+TEST(FrameThrottleOffByDefault)
+{
+	SimulatedBackend backend;
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	backend.SetForeground(nullptr);
+	FrameThrottle throttle(backend);
+	throttle.OnFrame(window);
+	backend.AdvanceTime(1000);
+	throttle.OnFrame(window);
+	CHECK_EQ(backend.GetTime(), 1000u);
+	CHECK_EQ(throttle.GetStats().throttledFrames, 0u);
+}
+
+TEST(FrameThrottleNeverSleepsThroughATransition)
+{
+	SimulatedBackend backend;
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	backend.SetForeground(nullptr);
+	FrameThrottle throttle(backend);
+	throttle.SetCap(20);
+	bool busy = true;
+	throttle.SetBusyCheck([&busy] { return busy; });
+	throttle.OnFrame(window);
+	backend.AdvanceTime(5000);
+	throttle.OnFrame(window);
+	CHECK_EQ(backend.GetTime(), 5000u);
+	CHECK_EQ(throttle.GetStats().throttledFrames, 0u);
+
+	busy = false;
+	throttle.OnFrame(window);
+	CHECK_EQ(backend.GetTime(), 55000u);
+	CHECK_EQ(throttle.GetStats().throttledFrames, 1u);
+	throttle.ResetStats();
+	CHECK_EQ(throttle.GetStats().throttledFrames, 0u);
+}
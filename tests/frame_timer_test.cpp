@@ -0,0 +1,48 @@
+#include "test.h"
+#include "frame_timer.h"
+
+TEST(FrameTimerReportsIntervalStatistics)
+{
+	FrameTimer timer;
+	uint64_t now = 1000;
+	timer.Tick(now);
+	for (int i = 0; i < 99; i++)
+	{
+		now += 16667;
+		timer.Tick(now);
+	}
+	now += 50000;
+	timer.Tick(now);
+
+	FrameStats stats = timer.GetStats();
+	CHECK_EQ(stats.frames, 100u);
+	CHECK_EQ(stats.p50Us, 16667u);
+	CHECK_EQ(stats.maxUs, 50000u);
+	CHECK_EQ(stats.stutterThresholdUs, 2u * 16667);
+	CHECK_EQ(stats.stutters, 1u);
+	CHECK_EQ(timer.GetStats(60000).stutters, 0u);
+
+	timer.Reset();
+	CHECK_EQ(timer.GetStats().frames, 0u);
+	now += 20000;
+	timer.Tick(now);
+	CHECK_EQ(timer.GetStats().frames, 1u);
+	CHECK_EQ(timer.GetStats().meanUs, 20000u);
+}
+
+TEST(FrameTimerKeepsOnlyTheNewestFrames)
+{
+	FrameTimer timer;
+	uint64_t now = 1;
+	timer.Tick(now);
+	for (size_t i = 0; i < FrameTimer::kCapacity + 10; i++)
+	{
+		now += i < 10 ? 100000 : 10000;
+		timer.Tick(now);
+	}
+
+	std::vector<uint32_t> intervals;
+	timer.GetIntervals(intervals);
+	CHECK_EQ(intervals.size(), FrameTimer::kCapacity);
+	CHECK_EQ(timer.GetStats().maxUs, 10000u);
+}
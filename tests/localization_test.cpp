@@ -0,0 +1,25 @@
+#include "test.h"
+#include "localization.h"
+
+static std::string Find(const std::vector<LocalizedString>& strings, const char* key)
+{
+	for (const LocalizedString& string : strings)
+	{
+		if (std::string(string.key) == key)
+			return string.text;
+	}
+	return std::string();
+}
+
+TEST(LocalizationBundleHasEveryLanguage)
+{
+	const std::vector<std::string> languages = GetLocalizationLanguages();
+	CHECK_EQ(languages.size(), 18u);
+	for (const std::string& language : languages)
+		CHECK_EQ(GetLocalizedStrings(language).size(), 3u);
+
+	const std::vector<LocalizedString> english = GetLocalizedStrings("english");
+	CHECK_EQ(Find(english, "menu_windowed"), std::string("Windowed"));
+	CHECK_EQ(Find(GetLocalizedStrings("russian"), "menu_windowed"), std::string("\320\222 \320\276\320\272\320\275\320\265"));
+	CHECK_EQ(Find(GetLocalizedStrings("klingon"), "menu_display_mode"), std::string("Display Mode"));
+}
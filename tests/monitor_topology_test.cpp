@@ -0,0 +1,130 @@
+#include "test.h"
+#include "display_mode.h"
+#include "simulated_backend.h"
+#include <thread>
+
+TEST(TopologyDescribesMonitors)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	backend.AddMonitorInfo(MonitorInfo{ nullptr, { 1920, 0, 4480, 1440 }, { 1920, 0, 4480, 1400 }, 144, 120, false, "\\\\.\\DISPLAY2" });
+	MonitorTopology topology(backend);
+	topology.Watch();
+
+	std::shared_ptr<const MonitorTopologySnapshot> snapshot = topology.GetSnapshot();
+	CHECK_EQ(snapshot->monitors.size(), 2u);
+	CHECK(snapshot->monitors[0].primary);
+	CHECK(!snapshot->monitors[1].primary);
+	CHECK_EQ(snapshot->monitors[1].refreshRate, 144);
+	CHECK_EQ(snapshot->monitors[1].dpi, 120u);
+	CHECK(snapshot->monitors[1].workArea == (WindowRect{ 1920, 0, 4480, 1400 }));
+	CHECK(snapshot->desktop == (WindowRect{ 0, 0, 4480, 1440 }));
+}
+
+TEST(TopologyIsOnlyRebuiltOnDisplayChange)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	CHECK_EQ(backend.GetQueryCount(), 1);
+
+	for (int i = 0; i < 5; i++)
+		controller.ChangeDisplayMode(i % 2 ? DISPLAY_MODE_WINDOWED : DISPLAY_MODE_FULLSCREEN_WINDOWED, 1280, 720, 0);
+	CHECK_EQ(backend.GetQueryCount(), 1);
+}
+
+TEST(TopologyFollowsHotPlug)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	std::shared_ptr<const MonitorTopologySnapshot> before = controller.GetTopology().GetSnapshot();
+
+	MonitorHandle second = backend.AddMonitor({ 1920, 0, 3840, 1080 });
+	controller.FullscreenWindowed(1);
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ 1920, 0, 3840, 1080 }));
+
+	// Readers holding the old snapshot are unaffected by the rebuild.
+	CHECK_EQ(before->monitors.size(), 1u);
+	CHECK(controller.GetTopology().GetSnapshot()->generation > before->generation);
+
+	MonitorInfo moved = controller.GetTopology().GetSnapshot()->monitors[1];
+	moved.rect = { -1920, 0, 0, 1080 };
+	backend.UpdateMonitor(moved);
+	controller.FullscreenWindowed(1);
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ -1920, 0, 0, 1080 }));
+
+	backend.RemoveMonitor(second);
+	CHECK_EQ(controller.GetTopology().GetSnapshot()->monitors.size(), 1u);
+	CHECK(controller.GetMonitorRect(1) == (WindowRect{ 0, 0, 1920, 1080 }));
+}
+
+TEST(AdaptersMapToMonitorsByDeviceName)
+{
+	SimulatedBackend backend;
+	backend.AddMonitorInfo(MonitorInfo{ nullptr, { 0, 0, 1920, 1080 }, { 0, 0, 1920, 1040 }, 60, 96, true, "\\\\.\\DISPLAY3" });
+	backend.AddMonitorInfo(MonitorInfo{ nullptr, { 1920, 0, 4480, 1440 }, { 1920, 0, 4480, 1440 }, 144, 96, false, "\\\\.\\DISPLAY1" });
+	// The second GPU enumerates first, so adapter 0 is the monitor EnumDisplayMonitors lists second.
+	backend.SetAdapterDevices({ "\\\\.\\DISPLAY1", "\\\\.\\DISPLAY3" });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+
+	std::shared_ptr<const MonitorTopologySnapshot> snapshot = controller.GetTopology().GetSnapshot();
+	CHECK(!snapshot->adapterMappingAmbiguous);
+	CHECK_EQ(snapshot->adapterMonitors.size(), 2u);
+	CHECK_EQ(snapshot->adapterMonitors[0], 1);
+	CHECK_EQ(snapshot->adapterMonitors[1], 0);
+
+	controller.FullscreenWindowed(0);
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ 1920, 0, 4480, 1440 }));
+
+	// Windowed centres on the adapter's monitor too, not on the primary one.
+	controller.Windowed(1280, 720, 0);
+	const WindowRect rect = backend.GetWindow(window).rect;
+	CHECK(rect.left >= 1920 && rect.right <= 4480);
+	CHECK_EQ(rect.left - 1920, 4480 - rect.right);
+}
+
+TEST(AmbiguousAdapterMappingIsReported)
+{
+	SimulatedBackend backend;
+	backend.AddMonitorInfo(MonitorInfo{ nullptr, { 0, 0, 1920, 1080 }, { 0, 0, 1920, 1080 }, 60, 96, true, "\\\\.\\DISPLAY1" });
+	backend.AddMonitorInfo(MonitorInfo{ nullptr, { 1920, 0, 3840, 1080 }, { 1920, 0, 3840, 1080 }, 60, 96, false, "\\\\.\\DISPLAY2" });
+	backend.SetAdapterDevices({ "\\\\.\\DISPLAY1", "\\\\.\\DISPLAY9" });
+	MonitorTopology topology(backend);
+	topology.Watch();
+
+	std::shared_ptr<const MonitorTopologySnapshot> snapshot = topology.GetSnapshot();
+	CHECK(snapshot->adapterMappingAmbiguous);
+	CHECK(snapshot->GetAdapterMonitor(0) == &snapshot->monitors[0]);
+	CHECK(snapshot->GetAdapterMonitor(1) == nullptr);
+	CHECK(snapshot->GetAdapterMonitor(2) == nullptr);
+}
+
+TEST(ConcurrentRebuildsPublishDistinctGenerations)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	MonitorTopology topology(backend);
+	CHECK_EQ(topology.GetSnapshot()->generation, 0u);
+	CHECK(!topology.GetSnapshot()->adapterMappingAmbiguous);
+
+	// Like Watch() on the game thread racing the display-change callback.
+	const int rebuilds = 200;
+	std::thread other([&] {
+		for (int i = 0; i < rebuilds; i++)
+			topology.Rebuild();
+	});
+	for (int i = 0; i < rebuilds; i++)
+		topology.Rebuild();
+	other.join();
+	CHECK_EQ(topology.GetSnapshot()->generation, 2u * rebuilds);
+}
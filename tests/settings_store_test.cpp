@@ -0,0 +1,123 @@
+#include "test.h"
+#include "settings_store.h"
+#include <cstdio>
+#include <fstream>
+
+static bool Exists(const std::string& path)
+{
+	return std::ifstream(path).good();
+}
+
+TEST(SettingsStoreCoalescesWrites)
+{
+	const std::string path = "settings_store_test.json";
+	std::remove(path.c_str());
+	{
+		SettingsStore store(path);
+		CHECK(!store.Load());
+		store.Start();
+		store.Set("display_mode", 2);
+		store.Set("display_mode", 1);
+		store.Set("display_mode", 2);
+		store.Set("window_x", -40);
+		store.Flush();
+		CHECK_EQ(store.GetWrites(), 1u);
+		CHECK(!Exists(path + ".tmp"));
+
+		// Setting the same value again is not a change.
+		store.Set("display_mode", 2);
+		store.Flush();
+		CHECK_EQ(store.GetWrites(), 1u);
+
+		store.Set("display_mode", 0);
+		store.Stop();
+		CHECK_EQ(store.GetWrites(), 2u);
+	}
+
+	SettingsStore reloaded(path);
+	CHECK(reloaded.Load());
+	double value = -1;
+	CHECK(reloaded.Get("display_mode", value));
+	CHECK_EQ(value, 0.0);
+	CHECK(reloaded.Get("window_x", value));
+	CHECK_EQ(value, -40.0);
+	std::remove(path.c_str());
+}
+
+TEST(SettingsStoreStopWritesChangesItsThreadMissed)
+{
+	const std::string path = "settings_store_stop_test.json";
+	std::remove(path.c_str());
+	{
+		// Stopped inside the coalescing delay, and changed again once stopped.
+		SettingsStore store(path);
+		store.Start();
+		store.Set("display_mode", 2);
+		store.Stop();
+		CHECK_EQ(store.GetWrites(), 1u);
+		store.Set("window_x", 10);
+		store.Stop();
+		CHECK_EQ(store.GetWrites(), 2u);
+		CHECK(!Exists(path + ".tmp"));
+	}
+
+	SettingsStore reloaded(path);
+	CHECK(reloaded.Load());
+	double value = -1;
+	CHECK(reloaded.Get("display_mode", value));
+	CHECK_EQ(value, 2.0);
+	CHECK(reloaded.Get("window_x", value));
+	CHECK_EQ(value, 10.0);
+	std::remove(path.c_str());
+}
+
+TEST(SettingsStoreReopenMovesToTheNewFile)
+{
+	const std::string oldPath = "settings_store_old_test.json";
+	const std::string newPath = "settings_store_new_test.json";
+	std::remove(oldPath.c_str());
+	std::remove(newPath.c_str());
+	{
+		SettingsStore other(newPath);
+		other.Set("display_mode", 1);
+		other.Stop();
+	}
+	{
+		SettingsStore store(oldPath);
+		store.Start();
+		store.Set("window_x", 10);
+		// The pending change still lands in the old file, the new one is loaded on top.
+		CHECK(store.Reopen(newPath));
+		CHECK(store.GetPath() == newPath);
+		double value = -1;
+		CHECK(store.Get("display_mode", value));
+		CHECK_EQ(value, 1.0);
+		store.Set("display_mode", 2);
+		store.Flush();
+	}
+
+	SettingsStore previous(oldPath);
+	CHECK(previous.Load());
+	double value = -1;
+	CHECK(previous.Get("window_x", value));
+	CHECK(!previous.Get("display_mode", value));
+	SettingsStore reloaded(newPath);
+	CHECK(reloaded.Load());
+	CHECK(reloaded.Get("display_mode", value));
+	CHECK_EQ(value, 2.0);
+	std::remove(oldPath.c_str());
+	std::remove(newPath.c_str());
+}
+
+TEST(SettingsStoreParsesLuaJson)
+{
+	std::map<std::string, double> values;
+	CHECK(SettingsStore::Parse("{ \"display_mode\" : 2, \"flag\": true,\"scale\":0.5 }\n", values));
+	CHECK_EQ(values["display_mode"], 2.0);
+	CHECK_EQ(values["flag"], 1.0);
+	CHECK_EQ(values["scale"], 0.5);
+	CHECK(SettingsStore::Parse("{}", values));
+	CHECK(!SettingsStore::Parse("{\"display_mode\":", values));
+	CHECK(!SettingsStore::Parse("[1]", values));
+	CHECK_EQ(SettingsStore::Format({ { "display_mode", 2 }, { "q\"", 0.5 } }), std::string("{\"display_mode\":2,\"q\\\"\":0.5}"));
+}
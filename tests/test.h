@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+
+// Minimal self-registering test harness, so the Linux build needs nothing beyond the compiler.
+struct TestCase
+{
+	const char* name;
+	void (*func)();
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportTestFailure(const char* file, int line, const char* expression);
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*func)()) { GetTestCases().push_back(TestCase{ name, func }); }
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistrar name##_registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) ReportTestFailure(__FILE__, __LINE__, #expression); } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
@@ -0,0 +1,41 @@
+#include "test.h"
+#include <cstring>
+
+static int g_failures;
+
+std::vector<TestCase>& GetTestCases()
+{
+	static std::vector<TestCase> cases;
+	return cases;
+}
+
+void ReportTestFailure(const char* file, int line, const char* expression)
+{
+	std::printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+	g_failures++;
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+	int run = 0;
+	for (const TestCase& test : GetTestCases())
+	{
+		if (argc > 1 && !std::strstr(test.name, argv[1]))
+			continue;
+		const int before = g_failures;
+		test.func();
+		run++;
+		if (g_failures != before)
+		{
+			std::printf("FAIL %s\n", test.name);
+			failed++;
+		}
+		else
+		{
+			std::printf("ok   %s\n", test.name);
+		}
+	}
+	std::printf("%d/%d tests passed\n", run - failed, run);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+#include "test.h"
+#include "simulated_backend.h"
+#include "trace_writer.h"
+#include "transition_worker.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+static std::string ReadFile(const std::string& path)
+{
+	std::ifstream file(path);
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+static size_t Count(const std::string& text, const std::string& needle)
+{
+	size_t count = 0;
+	for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1))
+		count++;
+	return count;
+}
+
+TEST(TraceCoversTransitionStages)
+{
+	const std::string path = "trace_writer_test.json";
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	CHECK(backend.SetMessageHook(window, [&controller](WindowMessage& message) { return controller.FilterMessage(message); }));
+	TraceWriter trace;
+	controller.SetTrace(&trace);
+	TransitionWorker worker(controller);
+	worker.Start();
+
+	// Events are ignored until the writer is started.
+	trace.Instant(TRACE_THREAD_GAME, "test", "before_start", 0);
+	CHECK(trace.Start(path));
+	CHECK(!trace.Start(path));
+	worker.Submit({ DISPLAY_MODE_WINDOWED, 1280, 720, 0 });
+	worker.WaitIdle();
+	trace.Complete(TRACE_THREAD_GAME, "frame", "frame", 100, 16667);
+	trace.Stop();
+	trace.Instant(TRACE_THREAD_GAME, "test", "after_stop", 0);
+	worker.Stop();
+
+	const std::string json = ReadFile(path);
+	std::remove(path.c_str());
+	CHECK_EQ(json.front(), '[');
+	CHECK(json.find("]") != std::string::npos);
+	CHECK_EQ(Count(json, "\"name\":\"change_display_mode\""), 1u);
+	CHECK_EQ(Count(json, "\"name\":\"transition\""), 1u);
+	CHECK_EQ(Count(json, "\"name\":\"style\""), 1u);
+	CHECK_EQ(Count(json, "\"name\":\"set_pos\""), 1u);
+	// The restyle and move are held back from the engine and released as one move and one size.
+	CHECK_EQ(Count(json, "\"name\":\"WM_WINDOWPOSCHANGED\",\"cat\":\"message\",\"ph\":\"i\",\"pid\":1,\"tid\":3"), 1u);
+	CHECK_EQ(Count(json, "\"action\":\"held\""), 1u);
+	CHECK_EQ(Count(json, "\"action\":\"released\""), 2u);
+	CHECK_EQ(Count(json, "\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":100,\"dur\":16667"), 1u);
+	CHECK_EQ(Count(json, "before_start") + Count(json, "after_stop"), 0u);
+	CHECK_EQ(trace.GetDropped(), 0u);
+}
@@ -0,0 +1,72 @@
+#include "test.h"
+#include "simulated_backend.h"
+#include "transition_worker.h"
+
+TEST(TimelineMeasuresStagesFromPreviousMark)
+{
+	SimulatedBackend backend;
+	backend.AdvanceTime(1000);
+	TransitionTimeline timeline(backend, 1000);
+	backend.AdvanceTime(200);
+	timeline.Mark(TRANSITION_STAGE_DISPATCH);
+	backend.AdvanceTime(300);
+	timeline.Mark(TRANSITION_STAGE_STYLE);
+	backend.AdvanceTime(400);
+	timeline.Mark(TRANSITION_STAGE_COMPLETE);
+
+	CHECK_EQ(timeline.GetDuration(TRANSITION_STAGE_DISPATCH), 200u);
+	CHECK(!timeline.Has(TRANSITION_STAGE_READY_WAIT));
+	CHECK_EQ(timeline.GetDuration(TRANSITION_STAGE_READY_WAIT), 0u);
+	CHECK_EQ(timeline.GetDuration(TRANSITION_STAGE_STYLE), 300u);
+	CHECK_EQ(timeline.GetDuration(TRANSITION_STAGE_COMPLETE), 400u);
+	CHECK_EQ(timeline.GetTotal(), 900u);
+}
+
+TEST(WorkerRecordsStatsPerMode)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	backend.SetPosCost(3000);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	TransitionWorker worker(controller);
+	worker.Start();
+
+	worker.Submit({ DISPLAY_MODE_WINDOWED, 1280, 720, 0 });
+	worker.WaitIdle();
+	worker.Submit({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1280, 720, 0 });
+	worker.WaitIdle();
+	worker.Submit({ DISPLAY_MODE_WINDOWED, 1600, 900, 0 });
+	worker.WaitIdle();
+
+	ModeTransitionStats windowed;
+	CHECK(worker.GetStats().Get(DISPLAY_MODE_WINDOWED, windowed));
+	CHECK_EQ(windowed.total.count, 2u);
+	CHECK_EQ(windowed.stages[TRANSITION_STAGE_SET_POS].minUs, 3000u);
+	CHECK_EQ(windowed.stages[TRANSITION_STAGE_READY_WAIT].count, 0u);
+	CHECK_EQ(windowed.stages[TRANSITION_STAGE_ADJUST_RECT].count, 2u);
+
+	ModeTransitionStats borderless;
+	CHECK(worker.GetStats().Get(DISPLAY_MODE_FULLSCREEN_WINDOWED, borderless));
+	CHECK_EQ(borderless.total.count, 1u);
+	CHECK_EQ(borderless.stages[TRANSITION_STAGE_READY_WAIT].count, 1u);
+	// The window was usable on the first look, so the wait took no time.
+	CHECK_EQ(borderless.stages[TRANSITION_STAGE_READY_WAIT].lastUs, 0u);
+	CHECK(borderless.total.lastUs >= 3000u);
+
+	worker.GetStats().Reset();
+	CHECK(worker.GetStats().Get(DISPLAY_MODE_WINDOWED, windowed));
+	CHECK_EQ(windowed.total.count, 0u);
+	CHECK(!worker.GetStats().Get(7, windowed));
+}
+
+TEST(PercentileUsesNearestRank)
+{
+	const std::vector<uint64_t> values = { 10, 20, 30, 40, 50, 60, 70, 80, 90, 100 };
+	CHECK_EQ(Percentile(values, 50), 50u);
+	CHECK_EQ(Percentile(values, 95), 100u);
+	CHECK_EQ(Percentile(values, 0), 10u);
+	CHECK_EQ(Percentile(std::vector<uint32_t>(), 99), 0u);
+}
@@ -0,0 +1,264 @@
+#include "test.h"
+#include "simulated_backend.h"
+#include "transition_worker.h"
+
+static WindowHandle Setup(SimulatedBackend& backend, DisplayModeController& controller)
+{
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 0, 0, 1920, 1080 }, BW_WS_POPUP | BW_WS_VISIBLE, 0);
+	controller.Attach();
+	controller.RefreshMonitors();
+	return window;
+}
+
+TEST(WorkerCoalescesPendingRequests)
+{
+	SimulatedBackend backend;
+	DisplayModeController controller(backend);
+	WindowHandle window = Setup(backend, controller);
+	TransitionWorker worker(controller);
+
+	// Not started yet, so everything queues up and only the newest survives.
+	CHECK_EQ(worker.GetLatestMode(), -1);
+	CHECK_EQ(worker.GetActiveRequest(), 0u);
+	worker.Submit({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1920, 1080, 0 });
+	worker.Submit({ DISPLAY_MODE_WINDOWED, 1280, 720, 0 });
+	const uint64_t newest = worker.Submit({ DISPLAY_MODE_WINDOWED, 1600, 900, 0 });
+	CHECK_EQ(worker.GetLatestMode(), DISPLAY_MODE_WINDOWED);
+	CHECK_EQ(worker.GetActiveRequest(), newest);
+	CHECK_EQ(controller.GetMode(), -1);
+	worker.Start();
+	worker.WaitIdle();
+	CHECK_EQ(worker.GetActiveRequest(), 0u);
+
+	TransitionWorker::Counters counters = worker.GetCounters();
+	CHECK_EQ(counters.submitted, 3u);
+	CHECK_EQ(counters.coalesced, 2u);
+	CHECK_EQ(counters.executed, 1u);
+	CHECK_EQ(backend.GetCalls().setPos, 1);
+	const WindowRect frame = backend.AdjustWindowRect({ 0, 0, 1600, 900 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE, BW_DEFAULT_DPI);
+	CHECK_EQ(backend.GetWindow(window).rect.Width(), frame.Width());
+}
+
+TEST(WorkerRunsRequestsSubmittedAfterIdle)
+{
+	SimulatedBackend backend;
+	DisplayModeController controller(backend);
+	WindowHandle window = Setup(backend, controller);
+	TransitionWorker worker(controller);
+	worker.Start();
+
+	worker.Submit({ DISPLAY_MODE_WINDOWED, 1280, 720, 0 });
+	worker.WaitIdle();
+	CHECK_EQ(backend.GetWindow(window).style, (uint32_t)PAYDAY2_WINDOWED_STYLE);
+
+	worker.Submit({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1280, 720, 0 });
+	worker.WaitIdle();
+	CHECK_EQ(backend.GetWindow(window).style, (uint32_t)PAYDAY2_FULLSCREEN_WINDOWED_STYLE);
+	CHECK_EQ(worker.GetCounters().executed, 2u);
+	worker.Stop();
+}
+
+TEST(WorkerFullscreenRequestCancelsPendingRestyle)
+{
+	SimulatedBackend backend;
+	DisplayModeController controller(backend);
+	WindowHandle window = Setup(backend, controller);
+	TransitionWorker worker(controller);
+
+	worker.Submit({ DISPLAY_MODE_WINDOWED, 1280, 720, 0 });
+	worker.Submit({ DISPLAY_MODE_FULLSCREEN, 1920, 1080, 0 });
+	worker.Start();
+	worker.WaitIdle();
+
+	CHECK_EQ(backend.GetCalls().Total(), 0);
+	CHECK_EQ(backend.GetWindow(window).style, BW_WS_POPUP | BW_WS_VISIBLE);
+}
+
+TEST(RollbackRestoresCapturedWindowInOneRestyle)
+{
+	SimulatedBackend backend;
+	DisplayModeController controller(backend);
+	WindowHandle window = Setup(backend, controller);
+	TransitionWorker worker(controller);
+	worker.Start();
+	worker.Submit({ DISPLAY_MODE_WINDOWED, 1280, 720, 0 });
+	worker.WaitIdle();
+	const SimulatedBackend::Window before = backend.GetWindow(window);
+
+	const int transaction = worker.BeginTransaction();
+	CHECK(transaction != 0);
+	worker.Submit({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1280, 720, 0 });
+	worker.WaitIdle();
+	CHECK_EQ(backend.GetWindow(window).style, (uint32_t)PAYDAY2_FULLSCREEN_WINDOWED_STYLE);
+
+	backend.ResetCounters();
+	CHECK(worker.RollbackTransaction(transaction));
+	worker.WaitIdle();
+
+	const SimulatedBackend::Window after = backend.GetWindow(window);
+	CHECK_EQ(after.style, before.style);
+	CHECK_EQ(after.exStyle, before.exStyle);
+	CHECK(after.rect == before.rect);
+	SimulatedBackend::Calls calls = backend.GetCalls();
+	CHECK_EQ(calls.setStyle, 1);
+	CHECK_EQ(calls.setExStyle, 1);
+	CHECK_EQ(calls.setPos, 1);
+	CHECK_EQ(calls.adjustRect, 0);
+	CHECK_EQ(calls.sleep, 0);
+	CHECK_EQ(controller.GetMode(), (int)DISPLAY_MODE_WINDOWED);
+
+	// A transaction can only be finished once.
+	CHECK(!worker.RollbackTransaction(transaction));
+	CHECK(!worker.CommitTransaction(transaction));
+	worker.Stop();
+}
+
+TEST(RollbackFollowsRearrangedMonitor)
+{
+	SimulatedBackend backend;
+	backend.AddMonitor({ 0, 0, 1920, 1080 });
+	MonitorHandle second = backend.AddMonitor({ 1920, 0, 3840, 1080 });
+	WindowHandle window = backend.CreateGameWindow({ 2000, 100, 2800, 700 }, PAYDAY2_WINDOWED_STYLE, PAYDAY2_WINDOWED_EX_STYLE);
+	DisplayModeController controller(backend);
+	controller.Attach();
+	controller.RefreshMonitors();
+	TransitionWorker worker(controller);
+	worker.Start();
+
+	const int transaction = worker.BeginTransaction();
+	worker.Submit({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1280, 720, 1 });
+	worker.WaitIdle();
+	MonitorInfo moved = controller.GetTopology().GetSnapshot()->monitors[1];
+	CHECK(moved.handle == second);
+	moved.rect = { -1920, 0, 0, 1080 };
+	backend.UpdateMonitor(moved);
+
+	CHECK(worker.RollbackTransaction(transaction));
+	worker.WaitIdle();
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ -1840, 100, -1040, 700 }));
+	worker.Stop();
+}
+
+TEST(OldTransactionsAreDropped)
+{
+	SimulatedBackend backend;
+	DisplayModeController controller(backend);
+	Setup(backend, controller);
+	TransitionWorker worker(controller);
+
+	const int first = worker.BeginTransaction();
+	for (int i = 0; i < 8; i++)
+		worker.BeginTransaction();
+	const int last = worker.BeginTransaction();
+	CHECK(!worker.CommitTransaction(first));
+	CHECK(worker.CommitTransaction(last));
+}
+
+TEST(WorkerQueuesResultsForTheGameThread)
+{
+	SimulatedBackend backend;
+	DisplayModeController controller(backend);
+	WindowHandle window = Setup(backend, controller);
+	TransitionWorker worker(controller);
+
+	worker.Submit({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1920, 1080, 0 });
+	const uint64_t id = worker.Submit({ DISPLAY_MODE_WINDOWED, 1280, 720, 0 });
+	worker.Start();
+	worker.WaitIdle();
+
+	std::vector<TransitionResult> results;
+	worker.TakeResults(results);
+	CHECK_EQ(results.size(), 1u);
+	CHECK_EQ(results[0].id, id);
+	CHECK(results[0].success);
+	CHECK_EQ(results[0].coalesced, 1u);
+	CHECK(results[0].rect == backend.GetWindow(window).rect);
+	CHECK(results[0].error.empty());
+
+	// Exclusive fullscreen that never ends, with the transition dropped on timeout.
+	controller.SetReadinessOptions({ 20, 16, 2, false });
+	SimulatedBackend::Window exclusive = backend.GetWindow(window);
+	exclusive.exclusiveFullscreen = true;
+	backend.ScheduleWindowState(window, backend.GetTime(), exclusive);
+	backend.AdvanceTime(1);
+	worker.Submit({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1920, 1080, 0 });
+	worker.WaitIdle();
+	worker.TakeResults(results);
+	CHECK_EQ(results.size(), 1u);
+	CHECK(!results[0].success);
+	CHECK(!results[0].error.empty());
+	CHECK_EQ(controller.GetMode(), DISPLAY_MODE_WINDOWED);
+
+	worker.TakeResults(results);
+	CHECK(results.empty());
+	worker.Stop();
+}
+
+TEST(RenderSettingsCallsAreAttributedToTheNextResult)
+{
+	SimulatedBackend backend;
+	DisplayModeController controller(backend);
+	Setup(backend, controller);
+	TransitionWorker worker(controller);
+	worker.Start();
+
+	worker.NoteRenderSettingsApplied();
+	worker.Submit({ DISPLAY_MODE_WINDOWED, 1280, 720, 0 });
+	worker.WaitIdle();
+	// Windowed to fullscreen windowed is a restyle the engine never hears about.
+	worker.Submit({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 1280, 720, 0 });
+	worker.WaitIdle();
+
+	std::vector<TransitionResult> results;
+	worker.TakeResults(results);
+	CHECK_EQ(results.size(), 2u);
+	CHECK_EQ(results[0].renderSettingsCalls, 1u);
+	CHECK_EQ(results[1].renderSettingsCalls, 0u);
+	CHECK_EQ(worker.GetCounters().renderSettingsCalls, 1u);
+	worker.Stop();
+}
+
+TEST(MinimizedWindowDefersEnforcedTransition)
+{
+	SimulatedBackend backend;
+	DisplayModeController controller(backend);
+	WindowHandle window = Setup(backend, controller);
+	CHECK(controller.ChangeDisplayMode(DISPLAY_MODE_WINDOWED, 1280, 720, 0));
+	const WindowRect windowed = backend.GetWindow(window).rect;
+	controller.SetFlipEnforced(true);
+	controller.SetReadinessOptions({ 20, 16, 2, true });
+	TransitionWorker worker(controller);
+	worker.Start();
+
+	// Still minimized after the ready wait: nothing is touched and the request is kept.
+	SimulatedBackend::Window minimized = backend.GetWindow(window);
+	minimized.minimized = true;
+	backend.ScheduleWindowState(window, backend.GetTime(), minimized);
+	backend.AdvanceTime(1);
+	const uint64_t id = worker.Submit({ DISPLAY_MODE_FULLSCREEN_WINDOWED, 0, 0, 0 });
+	worker.WaitIdle();
+	std::vector<TransitionResult> results;
+	worker.TakeResults(results);
+	CHECK_EQ(results.size(), 1u);
+	CHECK(!results[0].success);
+	CHECK(results[0].deferred);
+	CHECK(backend.GetWindow(window).rect == windowed);
+	CHECK_EQ(backend.GetWindow(window).style, (uint32_t)PAYDAY2_WINDOWED_STYLE);
+	CHECK_EQ(controller.GetMode(), DISPLAY_MODE_WINDOWED);
+	CHECK(worker.HasDeferred());
+
+	SimulatedBackend::Window restored = minimized;
+	restored.minimized = false;
+	backend.ScheduleWindowState(window, backend.GetTime(), restored);
+	backend.AdvanceTime(1);
+	CHECK(worker.ResumeDeferred());
+	worker.WaitIdle();
+	worker.TakeResults(results);
+	CHECK_EQ(results.size(), 1u);
+	CHECK_EQ(results[0].id, id);
+	CHECK(results[0].success);
+	CHECK(backend.GetWindow(window).rect == (WindowRect{ 0, 0, 1920, 1080 }));
+	CHECK(!worker.HasDeferred());
+	worker.Stop();
+}